@@ -12,10 +12,14 @@
 #include <sstream>
 #include <utility>
 #include <cctype>
+#include <cstring>
+#include <algorithm>
 #include "global.h"
 #include "board.h"
 #include "gamerecord.h"
 #include "timecontrol.h"
+#include "boardhistory.h"
+#include "timer.h"
 #include "arimaaio.h"
 
 using namespace std;
@@ -1341,7 +1345,9 @@ vector<move_t> ArimaaIO::readMoveSequence(const string& arg)
 	return moveList;
 }
 
-GameRecord ArimaaIO::readMoves(const string& arg)
+//Also reports the turn in progress at the end of the text and whether the text ended cleanly, right after a turn
+//token with no errors, so that IncrementalMoveReader can continue parsing from where this left off
+static GameRecord readMovesWithEndState(const string& arg, int& endMoveIndex, bool& endClean)
 {
 	string str = stripComments(arg);
 	str = Global::trim(str);
@@ -1354,6 +1360,7 @@ GameRecord ArimaaIO::readMoves(const string& arg)
   int moveIndex = -3; //Begins -3 because we have to pass 1w and 1b and 2w to begin actual moves
   move_t move = ERRORMOVE;
   pla_t activePla = SILV;
+  bool clean = true;
 
   //Read line by line...
   string line;
@@ -1398,6 +1405,7 @@ GameRecord ArimaaIO::readMoves(const string& arg)
 			{
 				//Clear move
 				move = ERRORMOVE;
+				clean = false;
 				break;
 			}
 
@@ -1406,7 +1414,7 @@ GameRecord ArimaaIO::readMoves(const string& arg)
 			{
 				//Numbers can't be too large
 				if(size > 10)
-				{cout << "ArimaaIO: value too large: " << wrd << endl; cout << str << endl; break;}
+				{cout << "ArimaaIO: value too large: " << wrd << endl; cout << str << endl; clean = false; break;}
 
 				//Count up
 				moveIndex++;
@@ -1415,7 +1423,7 @@ GameRecord ArimaaIO::readMoves(const string& arg)
 				//Ensure things match
 				int wrdnum = parseNumber(wrd,0,size-1);
 				if(wrdnum != (moveIndex+4)/2 || ((wrd[size-1] == 'g' || wrd[size-1] == 'w') != (activePla == GOLD)))
-				{cout << "ArimaaIO: turn number not valid: " << wrd << endl; cout << str << endl; break;}
+				{cout << "ArimaaIO: turn number not valid: " << wrd << endl; cout << str << endl; clean = false; break;}
 
 				//Append move, except if there were no steps at all, this probably is an empty move or follows a takeback or something
 				if(moveIndex >= 1 && move != ERRORMOVE)
@@ -1442,7 +1450,7 @@ GameRecord ArimaaIO::readMoves(const string& arg)
 				if(moveIndex < 0)
 					b.setPiece(placement.loc,placement.owner,placement.piece);
 				else
-				{cout << "ArimaaIO: illegal placement after first turn" << endl; cout << str << endl; break;}
+				{cout << "ArimaaIO: illegal placement after first turn" << endl; cout << str << endl; clean = false; break;}
 
 				continue;
 			}
@@ -1455,7 +1463,7 @@ GameRecord ArimaaIO::readMoves(const string& arg)
 
 				int ns = Board::numStepsInMove(move);
 				if(ns >= 4)
-				{cout << "ArimaaIO: Too many steps in move!" << endl; cout << str << endl; break;}
+				{cout << "ArimaaIO: Too many steps in move!" << endl; cout << str << endl; clean = false; break;}
 				move = Board::setStep(move,step,ns);
 
 				continue;
@@ -1463,11 +1471,14 @@ GameRecord ArimaaIO::readMoves(const string& arg)
 
 			cout << "ArimaaIO: Unknown move token: " << wrd << endl;
 			cout << str << endl;
+			clean = false;
 			break;
 		}
   }
 
   //Append a finishing move if one exists
+  if(move != ERRORMOVE)
+    clean = false;
   if(move != ERRORMOVE && moveIndex >= 0)
   {
     //Append a pass if not all steps taken and no pass
@@ -1533,31 +1544,172 @@ GameRecord ArimaaIO::readMoves(const string& arg)
 		else if(copy.noMoves(pla)) winner = opp;
   }
 
+  endMoveIndex = moveIndex;
+  endClean = clean && moveIndex >= 0 && (int)moveList.size() == moveIndex;
+
   map<string,string> keyValues = readKeyValues(str);
 
   return GameRecord(b,moveList,winner,keyValues);
 }
 
-vector<GameRecord> ArimaaIO::readMovesFile(const string& moveFile)
+GameRecord ArimaaIO::readMoves(const string& arg)
 {
-	return readMovesFile(moveFile.c_str());
+  int endMoveIndex;
+  bool endClean;
+  return readMovesWithEndState(arg,endMoveIndex,endClean);
 }
 
-vector<GameRecord> ArimaaIO::readMovesFile(const char* moveFile)
+//INCREMENTAL MOVES---------------------------------------------------------------
+
+IncrementalMoveReader::IncrementalMoveReader()
+:numFullReads(0),numIncrementalReads(0),numFullMoves(0),numMovesReused(0),fullSeconds(0),incrementalSeconds(0),
+ text(),canExtend(false),moveIndex(0),winner(NPLA),hist()
+{}
+
+const BoardHistory& IncrementalMoveReader::getHistory() const
 {
-  ifstream in;
-  if(!openFile(in,moveFile))
-  	Global::fatalError(string("ArimaaIO: could not open file: ") + moveFile);
+  return hist;
+}
 
-  string str;
-  vector<GameRecord> records;
-  while(getline(in,str,';'))
+pla_t IncrementalMoveReader::getWinner() const
+{
+  return winner;
+}
+
+double IncrementalMoveReader::getSecondsSaved() const
+{
+  if(numFullMoves <= 0)
+    return 0;
+  return fullSeconds / numFullMoves * numMovesReused - incrementalSeconds;
+}
+
+const BoardHistory& IncrementalMoveReader::read(const string& str)
+{
+  ClockTimer timer;
+
+  //The new text must extend the old one, and the old one must end on a token boundary
+  size_t len = text.size();
+  if(canExtend && str.size() >= len && str.compare(0,len,text) == 0 &&
+     (len == str.size() || isspace((unsigned char)text[len-1]) || isspace((unsigned char)str[len])))
   {
-    if(str.find_first_not_of(" \n\t\r") == string::npos)
+    int numMovesBefore = hist.maxTurnNumber - hist.minTurnNumber;
+    if(tryReadExtension(str.substr(len)))
+    {
+      text = str;
+      numIncrementalReads++;
+      numMovesReused += numMovesBefore;
+      incrementalSeconds += timer.getSeconds();
+      return hist;
+    }
+  }
+
+  readFull(str);
+  numFullReads++;
+  numFullMoves += hist.maxTurnNumber - hist.minTurnNumber;
+  fullSeconds += timer.getSeconds();
+  return hist;
+}
+
+void IncrementalMoveReader::readFull(const string& str)
+{
+  bool endClean;
+  GameRecord record = readMovesWithEndState(str,moveIndex,endClean);
+  hist = BoardHistory(record);
+  winner = record.winner;
+  text = str;
+
+  //Comments and key-value pairs could swallow text appended to them, so never continue from them
+  canExtend = endClean && str.find_first_of("#=") == string::npos;
+}
+
+//Follows the same rules as readMoves, but gives up on anything other than turn tokens and steps.
+//On failure, the state is left partially updated, the caller must do a full read.
+bool IncrementalMoveReader::tryReadExtension(const string& suffix)
+{
+  if(suffix.find_first_of("#=") != string::npos)
+    return false;
+
+  istringstream in(suffix);
+  string wrd;
+  move_t move = ERRORMOVE;
+  while(in >> wrd)
+  {
+    int size = wrd.size();
+
+    //Tokens like 2w, 34b - indicates turn change
+    if(size >= 2 && isNumber(wrd,0,size-1) && (wrd[size-1] == 'g' || wrd[size-1] == 'w' || wrd[size-1] == 's' || wrd[size-1] == 'b'))
+    {
+      if(size > 10)
+        return false;
+
+      moveIndex++;
+      pla_t activePla = ((moveIndex+4) % 2 == 0) ? GOLD : SILV;
+      int wrdnum = parseNumber(wrd,0,size-1);
+      if(wrdnum != (moveIndex+4)/2 || ((wrd[size-1] == 'g' || wrd[size-1] == 'w') != (activePla == GOLD)))
+        return false;
+
+      //An empty move would leave a hole in the move list, and nothing may follow a win
+      if(move == ERRORMOVE || winner != NPLA)
+        return false;
+
+      move = Board::completeTurn(move);
+      Board copy = hist.turnBoard[hist.maxTurnNumber];
+      step_t oldStep = copy.step;
+      if(!copy.makeMoveLegal(move))
+        return false;
+      hist.reportMove(copy,move,oldStep);
+
+      //Check winning conditions
+      pla_t pla = copy.player;
+      pla_t opp = OPP(pla);
+      if(copy.isGoal(opp)) winner = opp;
+      else if(copy.isGoal(pla)) winner = pla;
+      else if(copy.isRabbitless(pla)) winner = opp;
+      else if(copy.isRabbitless(opp)) winner = pla;
+      else if(copy.noMoves(pla)) winner = opp;
+
+      move = ERRORMOVE;
+      continue;
+    }
+
+    Placement placement;
+    if(tryReadPlacement(wrd,placement))
+      return false;
+
+    step_t step;
+    if(tryReadStep(wrd,step))
+    {
+      if(step == ERRORSTEP)
+        continue;
+
+      int ns = Board::numStepsInMove(move);
+      if(ns >= 4)
+        return false;
+      move = Board::setStep(move,step,ns);
       continue;
-    records.push_back(readMoves(unescapeGameStateString(str)));
+    }
+
+    //Takebacks, resigns, unknown tokens
+    return false;
   }
-  in.close();
+
+  //A partial move at the end is completed by readMoves, but then we could not continue from it
+  return move == ERRORMOVE;
+}
+
+vector<GameRecord> ArimaaIO::readMovesFile(const string& moveFile)
+{
+	return readMovesFile(moveFile.c_str());
+}
+
+vector<GameRecord> ArimaaIO::readMovesFile(const char* moveFile)
+{
+  //One sequential pass, so there's no need to map the file
+  MovesFileReader reader(moveFile,false);
+  vector<GameRecord> records;
+  GameRecord record;
+  while(reader.next(record))
+    records.push_back(record);
   return records;
 }
 
@@ -1571,28 +1723,188 @@ GameRecord ArimaaIO::readMovesFile(const char* moveFile, int idx)
   if(idx < 0)
   	Global::fatalError(string("ArimaaIO: idx is negative: ") + Global::intToString(idx));
 
-  ifstream in;
-  if(!openFile(in,moveFile))
-  	Global::fatalError(string("ArimaaIO: could not open file: ") + moveFile);
+  MovesFileReader reader(moveFile);
+  return reader.get(idx);
+}
 
-  string str;
-  GameRecord record;
-  int i = 0;
-  while(getline(in,str,';'))
-  {
-    if(str.find_first_not_of(" \n\t\r") == string::npos)
-      continue;
-    if(i < idx)
-    {i++; continue;}
-    record = readMoves(unescapeGameStateString(str));
-    i++;
-    break;
-  }
-  if(i <= idx)
-  	Global::fatalError(string("ArimaaIO: could not find idx ") + Global::intToString(idx) + " in file: " + moveFile);
+//MOVES FILE READER-------------------------------------------------------------
 
-  in.close();
-  return record;
+//Returns the path that openFile would open, or the empty string if there is none
+static string findFile(const string& s)
+{
+	ifstream in;
+	in.open(s.c_str());
+	if(!in.fail())
+		return s;
+
+	if(defaultDir == string(""))
+		return string();
+
+	string path = defaultDir + "/" + s;
+	in.clear();
+	in.open(path.c_str());
+	if(!in.fail())
+		return path;
+	return string();
+}
+
+static inline bool isRecordWhitespace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+MovesFileReader::MovesFileReader(const string& moveFile, bool mapping)
+:fileName(),useMapping(mapping),mapped(),in(),fileSize(0),mutex(),recordStart(),recordEnd(),scanPos(0),nextIdx(0),
+ chunk(),chunkStart(0),chunkLen(0)
+{
+	fileName = findFile(moveFile);
+	if(fileName.size() == 0)
+		Global::fatalError(string("ArimaaIO: could not open file: ") + moveFile);
+
+	in.open(fileName.c_str(), ios::in | ios::binary);
+	if(in.fail())
+		Global::fatalError(string("ArimaaIO: could not open file: ") + moveFile);
+	in.seekg(0,ios::end);
+	fileSize = in.tellg();
+
+	//A file bigger than the address space can't be mapped (or even read whole), so stream it instead
+	if(!MappedFile::fitsInMemory(fileSize))
+		useMapping = false;
+
+	if(useMapping)
+	{
+		in.close();
+		mapped.open(fileName);
+		fileSize = mapped.size();
+	}
+	else
+		chunk.resize(1 << 16);
+}
+
+MovesFileReader::~MovesFileReader()
+{
+
+}
+
+//Scan from scanPos to the next ';' or the end of the file and index the record there, skipping records that are
+//entirely whitespace the same way readMovesFile always has. Returns false if there are no more records.
+bool MovesFileReader::indexNextRecord()
+{
+	while(scanPos < fileSize)
+	{
+		uint64_t start = scanPos;
+		uint64_t end = fileSize;
+		bool blank = true;
+		if(useMapping)
+		{
+			const char* data = mapped.data();
+			const char* sep = (const char*)memchr(data+start,';',(size_t)(fileSize-start));
+			if(sep != NULL)
+				end = sep-data;
+			for(uint64_t i = start; i<end && blank; i++)
+				if(!isRecordWhitespace(data[i]))
+					blank = false;
+		}
+		else
+		{
+			uint64_t pos = start;
+			bool found = false;
+			while(pos < fileSize && !found)
+			{
+				if(pos < chunkStart || pos >= chunkStart + chunkLen)
+					fillChunk(pos);
+				for(; pos < chunkStart + chunkLen; pos++)
+				{
+					char c = chunk[pos - chunkStart];
+					if(c == ';')
+					{end = pos; found = true; break;}
+					if(blank && !isRecordWhitespace(c))
+						blank = false;
+				}
+			}
+		}
+
+		scanPos = end+1;
+		if(!blank)
+		{
+			recordStart.push_back(start);
+			recordEnd.push_back(end);
+			return true;
+		}
+	}
+	return false;
+}
+
+void MovesFileReader::fillChunk(uint64_t pos)
+{
+	uint64_t len = min((uint64_t)chunk.size(), fileSize-pos);
+	in.clear();
+	in.seekg(pos);
+	in.read(chunk.data(),len);
+	if(in.fail())
+		Global::fatalError(string("ArimaaIO: error reading file: ") + fileName);
+	chunkStart = pos;
+	chunkLen = len;
+}
+
+//Index up to record idx, returns false if there is no such record
+bool MovesFileReader::findRecord(int idx)
+{
+	while((int)recordStart.size() <= idx)
+		if(!indexNextRecord())
+			return false;
+	return true;
+}
+
+string MovesFileReader::getRecordText(int idx)
+{
+	uint64_t start = recordStart[idx];
+	uint64_t len = recordEnd[idx] - start;
+	if(useMapping)
+		return string(mapped.data()+start,len);
+
+	string text(len,' ');
+	in.clear();
+	in.seekg(start);
+	in.read(&text[0],len);
+	if(in.fail())
+		Global::fatalError(string("ArimaaIO: error reading file: ") + fileName);
+	return text;
+}
+
+bool MovesFileReader::next(GameRecord& record)
+{
+	string text;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(!findRecord(nextIdx))
+			return false;
+		text = getRecordText(nextIdx);
+		nextIdx++;
+	}
+	record = readMoves(unescapeGameStateString(text));
+	return true;
+}
+
+GameRecord MovesFileReader::get(int idx)
+{
+	string text;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(idx < 0 || !findRecord(idx))
+			Global::fatalError(string("ArimaaIO: could not find idx ") + Global::intToString(idx) + " in file: " + fileName);
+		text = getRecordText(idx);
+		nextIdx = idx+1;
+	}
+	return readMoves(unescapeGameStateString(text));
+}
+
+int MovesFileReader::numRecords()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	while(indexNextRecord())
+	{}
+	return recordStart.size();
 }
 
 
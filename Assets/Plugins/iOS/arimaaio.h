@@ -58,10 +58,14 @@
 #include <string>
 #include <sstream>
 #include <map>
+#include <fstream>
+#include <mutex>
 #include "global.h"
 #include "board.h"
 #include "gamerecord.h"
+#include "boardhistory.h"
 #include "timecontrol.h"
+#include "mappedfile.h"
 
 using namespace std;
 
@@ -170,6 +174,88 @@ namespace ArimaaIO
 	GameRecord readMovesFile(const string& moveFile, int idx);
 	GameRecord readMovesFile(const char* moveFile, int idx);
 
+	//Reads a game whose move text only grows at the end from one call to the next, such as the game passed to the
+	//bot every turn. Keeps the parse state and the history from the previous call so that when the text extends
+	//the previous text, only the appended text is parsed and only the new moves are played.
+	//Anything else (takebacks, placements, comments, key-value pairs, a different game) falls back to a full
+	//readMoves, so the result is always the same as BoardHistory(readMoves(str)).
+	class IncrementalMoveReader
+	{
+		public:
+		IncrementalMoveReader();
+
+		//Read the given full move text, returns the history of the game up to the current position
+		const BoardHistory& read(const string& str);
+
+		const BoardHistory& getHistory() const;
+		pla_t getWinner() const;
+
+		//Stats
+		int64_t numFullReads;
+		int64_t numIncrementalReads;
+		int64_t numFullMoves;         //Total moves parsed and played by full reads
+		int64_t numMovesReused;       //Total moves incremental reads kept instead of parsing and playing again
+		double fullSeconds;           //Total time spent in full reads
+		double incrementalSeconds;    //Total time spent in incremental reads
+
+		//Estimate of the time saved over always doing a full read, based on the average cost per move of full reads
+		double getSecondsSaved() const;
+
+		private:
+		string text;         //The text read so far
+		bool canExtend;      //Did the text end right after a turn token, with no errors, so that we can continue from it?
+		int moveIndex;       //The turn in progress at the end of the text, numbered as in readMoves
+		pla_t winner;
+		BoardHistory hist;
+
+		void readFull(const string& str);
+		bool tryReadExtension(const string& suffix);
+	};
+
+	//Reads the game records of a moves file one at a time, instead of holding them all in memory like readMovesFile.
+	//Records are split exactly as readMovesFile does. The byte range of each record is indexed lazily, as the file is
+	//scanned for records, so once record idx has been reached, reading it again is just a seek.
+	//The file is memory mapped if useMapping, else read through a stream. Threadsafe, and parsing is done outside
+	//the lock, so many threads can share one reader.
+	class MovesFileReader
+	{
+		public:
+		MovesFileReader(const string& moveFile, bool useMapping = true);
+		~MovesFileReader();
+
+		//Read the next record after the last one read, returns false if there are no more
+		bool next(GameRecord& record);
+		//Read record idx, fatal error if there is no such record. next() then continues with idx+1.
+		GameRecord get(int idx);
+		//Index the whole file if not already done, returning the total number of records
+		int numRecords();
+
+		private:
+		string fileName;
+		bool useMapping;
+		MappedFile mapped;
+		ifstream in;
+		uint64_t fileSize;
+
+		std::mutex mutex;
+		vector<uint64_t> recordStart; //Byte range of each record found so far, excluding the ';'
+		vector<uint64_t> recordEnd;
+		uint64_t scanPos;             //Where to resume scanning for records
+		int nextIdx;                  //Record that next() reads
+
+		vector<char> chunk;           //Buffer for scanning when not mapped, holding the bytes from chunkStart on
+		uint64_t chunkStart;
+		uint64_t chunkLen;
+
+		bool indexNextRecord();
+		void fillChunk(uint64_t pos);
+		bool findRecord(int idx);
+		string getRecordText(int idx);
+
+		MovesFileReader(const MovesFileReader&);
+		MovesFileReader& operator=(const MovesFileReader&);
+	};
+
 	//GAME STATE-----------------------------------------------------------------
 
   //Parses a given gamestate file into key-value pairs and unescapes the characters in the values.
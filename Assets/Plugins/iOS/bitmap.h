@@ -11,6 +11,26 @@
 
 #include <iostream>
 #include <stdint.h>
+
+//Bit counting and scanning use the hardware instructions where the compiler is targeting them, else the portable
+//table and SWAR versions. Chosen at compile time since these are inlined into nearly every hot loop.
+//Build with -mpopcnt or -march=... on x86-64 to get POPCNT, ARM64 always has CNT and RBIT/CLZ.
+//Define BITMAP_NO_INTRINSICS to force the portable versions, such as to benchmark against them.
+#ifndef BITMAP_NO_INTRINSICS
+  #if defined(__GNUC__) || defined(__clang__)
+    #define BITMAP_BUILTIN_CTZ
+    #if defined(__POPCNT__) || defined(__aarch64__) || defined(__ARM_NEON)
+      #define BITMAP_BUILTIN_POPCOUNT
+    #endif
+  #elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    #include <intrin.h>
+    #define BITMAP_MSVC_CTZ
+    #if defined(_M_X64) && defined(__AVX__)
+      #define BITMAP_MSVC_POPCOUNT
+    #endif
+  #endif
+#endif
+
 using namespace std;
 
 static const int nextBitArr[64] =
@@ -162,12 +182,18 @@ struct Bitmap
 	// http://chessprogramming.wikispaces.com/BitScan
 	inline int nextBit()
 	{
-		//int bit =  __builtin_ctzll(bits);
+#if defined(BITMAP_BUILTIN_CTZ)
+		int bit = __builtin_ctzll(bits);
+#elif defined(BITMAP_MSVC_CTZ)
+		unsigned long bit;
+		_BitScanForward64(&bit,bits);
+#else
 	  uint64_t b = bits ^ (bits-1);
 	  uint32_t folded = (int)(b ^ (b >> 32));
 	  int bit = nextBitArr[(folded * 0x78291ACF) >> 26];
+#endif
 		bits &= (bits-1);
-		return bit;
+		return (int)bit;
 	}
 
 	inline int countBitsIterative() const
@@ -182,9 +208,13 @@ struct Bitmap
 		return count;
 	}
 
-	inline int countBits() const //TODO this might be speedupable by switiching to a 64 bit version?
+	inline int countBits() const
 	{
-		//return __builtin_popcountll(bits);
+#if defined(BITMAP_BUILTIN_POPCOUNT)
+		return __builtin_popcountll(bits);
+#elif defined(BITMAP_MSVC_POPCOUNT)
+		return (int)__popcnt64(bits);
+#else
 	  uint32_t v = (uint32_t)bits;
 		v = v - ((v >> 1) & 0x55555555U);
 		v = (v & 0x33333333U) + ((v >> 2) & 0x33333333U);
@@ -196,6 +226,21 @@ struct Bitmap
 		uint32_t d = (w + (w >> 4)) & 0x0F0F0F0FU;
 
 		return (int)(((c + d) * 0x01010101U) >> 24);
+#endif
+	}
+
+	//Which versions of nextBit and countBits were compiled in
+	static inline const char* getIntrinsicsDesc()
+	{
+#if defined(BITMAP_BUILTIN_CTZ) || defined(BITMAP_MSVC_CTZ)
+#if defined(BITMAP_BUILTIN_POPCOUNT) || defined(BITMAP_MSVC_POPCOUNT)
+		return "hardware ctz, hardware popcount";
+#else
+		return "hardware ctz, portable popcount";
+#endif
+#else
+		return "portable ctz, portable popcount";
+#endif
 	}
 
 	inline void print(ostream& out) const
@@ -9,6 +9,7 @@
 #include <sstream>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <vector>
 #include "global.h"
 #include "rand.h"
@@ -293,6 +294,17 @@ void Board::makeMove(move_t m)
 }
 
 bool Board::makeMoveLegal(move_t m)
+{
+	return makeMoveLegal(m,NULL);
+}
+
+bool Board::makeMoveLegal(move_t m, UndoMoveData& udata)
+{
+	beginUndo(udata);
+	return makeMoveLegal(m,&udata);
+}
+
+bool Board::makeMoveLegal(move_t m, UndoMoveData* udata)
 {
 	if(m == ERRORMOVE)
 		return false;
@@ -357,7 +369,14 @@ bool Board::makeMoveLegal(move_t m)
 			}
 		}
 
-		makeStep(s);
+		if(udata != NULL)
+		{
+			makeStepRaw(s,*udata);
+			if(s != PASSSTEP)
+				recalculateFreezeMap();
+		}
+		else
+			makeStep(s);
 
 		if(s == PASSSTEP)
 		  return true;
@@ -369,6 +388,117 @@ bool Board::makeMoveLegal(move_t m)
 	return true;
 }
 
+void Board::makeMove(move_t m, UndoMoveData& udata)
+{
+	beginUndo(udata);
+	bool recalcFreeze = false;
+	for(int i = 0; i<4; i++)
+	{
+	  step_t s = Board::getStep(m,i);
+		if(s == ERRORSTEP || s == QPASSSTEP){break;}
+		makeStepRaw(s,udata);
+		if(s == PASSSTEP){break;}
+		recalcFreeze = true;
+	}
+
+	if(recalcFreeze)
+		recalculateFreezeMap();
+}
+
+void Board::beginUndo(UndoMoveData& udata) const
+{
+	udata.player = player;
+	udata.step = step;
+	udata.turnNumber = turnNumber;
+	memcpy(udata.trapGuardCounts,trapGuardCounts,sizeof(trapGuardCounts));
+	udata.frozenMap = frozenMap;
+	udata.posStartHash = posStartHash;
+	udata.posCurrentHash = posCurrentHash;
+	udata.sitCurrentHash = sitCurrentHash;
+	udata.numSteps = 0;
+}
+
+void Board::makeStepRaw(step_t s, UndoMoveData& udata)
+{
+	if(s == PASSSTEP || s == QPASSSTEP)
+	{
+		makeStepRaw(s);
+		return;
+	}
+
+	int idx = udata.numSteps++;
+	loc_t k0 = K0INDEX[s];
+	loc_t k1 = K1INDEX[s];
+	udata.k0[idx] = k0;
+	udata.k1[idx] = k1;
+
+	//The only piece this step can capture is the one on the trap next to k0 - which is the stepping piece itself
+	//if it steps onto that trap
+	loc_t caploc = ADJACENTTRAP[k0];
+	pla_t capOwner = NPLA;
+	piece_t capPiece = EMP;
+	if(caploc != ERRORSQUARE)
+	{
+		loc_t src = (caploc == k1) ? k0 : caploc;
+		capOwner = owners[src];
+		capPiece = pieces[src];
+	}
+
+	makeStepRaw(s);
+
+	if(capOwner != NPLA && owners[caploc] == NPLA)
+	{
+		udata.capLoc[idx] = caploc;
+		udata.capOwner[idx] = capOwner;
+		udata.capPiece[idx] = capPiece;
+	}
+	else
+		udata.capLoc[idx] = ERRORSQUARE;
+}
+
+void Board::undoMove(const UndoMoveData& udata)
+{
+	for(int i = udata.numSteps-1; i >= 0; i--)
+	{
+		//Put back anything captured
+		loc_t caploc = udata.capLoc[i];
+		if(caploc != ERRORSQUARE)
+		{
+			pla_t owner = udata.capOwner[i];
+			piece_t piece = udata.capPiece[i];
+			owners[caploc] = owner;
+			pieces[caploc] = piece;
+			pieceMaps[owner][piece].setOn(caploc);
+			pieceMaps[owner][0].setOn(caploc);
+			pieceCounts[owner][piece]++;
+			pieceCounts[owner][0]++;
+		}
+
+		//Step the piece back
+		loc_t k0 = udata.k0[i];
+		loc_t k1 = udata.k1[i];
+		pla_t pla = owners[k1];
+		piece_t piece = pieces[k1];
+		owners[k0] = pla;
+		pieces[k0] = piece;
+		owners[k1] = NPLA;
+		pieces[k1] = EMP;
+		pieceMaps[pla][piece].setOff(k1);
+		pieceMaps[pla][piece].setOn(k0);
+		pieceMaps[pla][0].setOff(k1);
+		pieceMaps[pla][0].setOn(k0);
+	}
+
+	player = udata.player;
+	step = udata.step;
+	turnNumber = udata.turnNumber;
+	memcpy(trapGuardCounts,udata.trapGuardCounts,sizeof(trapGuardCounts));
+	frozenMap = udata.frozenMap;
+	posStartHash = udata.posStartHash;
+	posCurrentHash = udata.posCurrentHash;
+	sitCurrentHash = udata.sitCurrentHash;
+}
+
 bool Board::makeMoveLegalUpTo(move_t m, int numSteps)
 {
 	if(m == ERRORMOVE)
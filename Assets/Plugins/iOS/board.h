@@ -128,6 +128,32 @@ class TempRecord
   }
 };
 
+//MOVE UNDO CLASS--------------------------------------------------------------------------------------
+//Unlike TempRecord, records everything needed to exactly restore the board after a full makeMove or
+//makeMoveLegal, including bitmaps, freezing, counts and hashes. Much smaller than a Board, so that search can
+//make and undo moves instead of copying the whole board.
+
+class UndoMoveData
+{
+  public:
+  //Saved state, restored wholesale
+  int8_t player;
+  int8_t step;
+  int turnNumber;
+  int8_t trapGuardCounts[2][4];
+  Bitmap frozenMap;
+  hash_t posStartHash;
+  hash_t posCurrentHash;
+  hash_t sitCurrentHash;
+
+  //Each step that moved a piece, in order, and the piece it captured if any (at most one per step)
+  int numSteps;
+  loc_t k0[4];
+  loc_t k1[4];
+  loc_t capLoc[4]; //ERRORSQUARE if nothing captured
+  pla_t capOwner[4];
+  piece_t capPiece[4];
+};
 
 //PRIMARY CLASS----------------------------------------------------------------------------------------
 
@@ -328,9 +354,29 @@ class Board
 	 */
 	bool makeMovesLegal(vector<move_t> moves, int start = 0, int end = 0x7FFFFFFF);
 
+	/**
+	 * Same as makeMove and makeMoveLegal, but fill in udata so that undoMove(udata) restores the board exactly.
+	 * For makeMoveLegal, undoMove must be called even if the move was illegal, to take back the steps up to the
+	 * point of illegality.
+	 */
+	void makeMove(move_t m, UndoMoveData& udata);
+	bool makeMoveLegal(move_t m, UndoMoveData& udata);
+
+	/**
+	 * Undo a move made with makeMove or makeMoveLegal that filled in udata. Moves made since then must already be undone.
+	 */
+	void undoMove(const UndoMoveData& udata);
+
 	private:
+	friend class CompactBoard;
 	//Makes a step, assuming that s is legal, and updates everything EXCEPT the freeze bitmap.
 	void makeStepRaw(step_t s);
+	//Same, but also records the step in udata
+	void makeStepRaw(step_t s, UndoMoveData& udata);
+	//Save the state that undoMove restores wholesale, and clear the recorded steps
+	void beginUndo(UndoMoveData& udata) const;
+	//makeMoveLegal, recording steps in udata if not NULL
+	bool makeMoveLegal(move_t m, UndoMoveData* udata);
 	//Updates the freeze bitmap.
 	void recalculateFreezeMap();
 	//Check if k is a trap, and resolve captures, recording the hash change in hashDiff
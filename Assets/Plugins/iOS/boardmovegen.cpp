@@ -193,80 +193,60 @@ int BoardMoveGen::genPushPulls(const Board& b, pla_t pla, move_t* mv)
 {
   pla_t opp = OPP(pla);
 
-	Bitmap pushMap = b.pieceMaps[pla][0];
-	pushMap &= ~b.frozenMap;           //Must be unfrozen
-	pushMap &= ~b.pieceMaps[pla][RAB]; //Rabbits can't push
-	pushMap = Bitmap::adj(pushMap);
-	pushMap &= b.pieceMaps[opp][0];    //Must have opp to push
-	pushMap &= ~b.pieceMaps[opp][ELE]; //Elephants can't be pushed
-	pushMap &= Bitmap::adj(Bitmap::BMPONES & (~b.pieceMaps[pla][0]) & (~b.pieceMaps[opp][0])); //Must have empty space
+  Bitmap empty = ~(b.pieceMaps[pla][0] | b.pieceMaps[opp][0]);
+  Bitmap notFrozen = ~b.frozenMap;
+
+  //For each direction, the opp pieces that the pla piece in that direction can push, and the pla pieces that can
+  //pull the opp piece in that direction. Built a strength layer at a time from the top, as in initializeStrongerMaps,
+  //so rabbits never push or pull and elephants are never pushed or pulled.
+  Bitmap ppS, ppW, ppE, ppN;
+  Bitmap strongerMap;
+  for(piece_t piece = CAM; piece >= RAB; piece--)
+  {
+    strongerMap |= b.pieceMaps[pla][piece+1] & notFrozen;
+    Bitmap oppMap = b.pieceMaps[opp][piece];
+    if(oppMap.isEmpty() || strongerMap.isEmpty())
+      continue;
+    ppS |= (oppMap & Bitmap::shiftN(strongerMap)) | (strongerMap & Bitmap::shiftN(oppMap));
+    ppW |= (oppMap & Bitmap::shiftE(strongerMap)) | (strongerMap & Bitmap::shiftE(oppMap));
+    ppE |= (oppMap & Bitmap::shiftW(strongerMap)) | (strongerMap & Bitmap::shiftW(oppMap));
+    ppN |= (oppMap & Bitmap::shiftS(strongerMap)) | (strongerMap & Bitmap::shiftS(oppMap));
+  }
 
-	Bitmap pullMap = b.pieceMaps[opp][0];
-	pullMap &= ~b.pieceMaps[opp][ELE]; //Elephants can't be pulled
-	pullMap = Bitmap::adj(pullMap);
-	pullMap &= b.pieceMaps[pla][0];    //Must have pla to pull
-	pullMap &= ~b.frozenMap;           //Must be unfrozen
-	pullMap &= ~b.pieceMaps[pla][RAB]; //Rabbits can't pull
-	pullMap &= Bitmap::adj(Bitmap::BMPONES & (~b.pieceMaps[pla][0]) & (~b.pieceMaps[opp][0])); //Must have empty space
+  //Squares with an empty neighbor in each direction
+  Bitmap empS = Bitmap::shiftN(empty);
+  Bitmap empW = Bitmap::shiftE(empty);
+  Bitmap empE = Bitmap::shiftW(empty);
+  Bitmap empN = Bitmap::shiftS(empty);
 
-	int num = 0;
-	while(pushMap.hasBits())
-	{
-		loc_t k = pushMap.nextBit();
-		if(CS1(k) && ISP(k S) && GT(k S,k) && b.isThawed(k S))
-		{
-			if(CW1(k) && ISE(k W)){mv[num++] = Board::getMove(k MW,k S MN);}
-			if(CE1(k) && ISE(k E)){mv[num++] = Board::getMove(k ME,k S MN);}
-			if(CN1(k) && ISE(k N)){mv[num++] = Board::getMove(k MN,k S MN);}
-		}
-		if(CW1(k) && ISP(k W) && GT(k W,k) && b.isThawed(k W))
-		{
-			if(CS1(k) && ISE(k S)){mv[num++] = Board::getMove(k MS,k W ME);}
-			if(CE1(k) && ISE(k E)){mv[num++] = Board::getMove(k ME,k W ME);}
-			if(CN1(k) && ISE(k N)){mv[num++] = Board::getMove(k MN,k W ME);}
-		}
-		if(CE1(k) && ISP(k E) && GT(k E,k) && b.isThawed(k E))
-		{
-			if(CS1(k) && ISE(k S)){mv[num++] = Board::getMove(k MS,k E MW);}
-			if(CW1(k) && ISE(k W)){mv[num++] = Board::getMove(k MW,k E MW);}
-			if(CN1(k) && ISE(k N)){mv[num++] = Board::getMove(k MN,k E MW);}
-		}
-		if(CN1(k) && ISP(k N) && GT(k N,k) && b.isThawed(k N))
-		{
-			if(CS1(k) && ISE(k S)){mv[num++] = Board::getMove(k MS,k N MS);}
-			if(CW1(k) && ISE(k W)){mv[num++] = Board::getMove(k MW,k N MS);}
-			if(CE1(k) && ISE(k E)){mv[num++] = Board::getMove(k ME,k N MS);}
-		}
-	}
-	while(pullMap.hasBits())
-	{
-	  loc_t k = pullMap.nextBit();
-		if(CS1(k) && ISO(k S) && GT(k,k S))
-		{
-			if(CW1(k) && ISE(k W)){mv[num++] = Board::getMove(k MW,k S MN);}
-			if(CE1(k) && ISE(k E)){mv[num++] = Board::getMove(k ME,k S MN);}
-			if(CN1(k) && ISE(k N)){mv[num++] = Board::getMove(k MN,k S MN);}
-		}
-		if(CW1(k) && ISO(k W) && GT(k,k W))
-		{
-			if(CS1(k) && ISE(k S)){mv[num++] = Board::getMove(k MS,k W ME);}
-			if(CE1(k) && ISE(k E)){mv[num++] = Board::getMove(k ME,k W ME);}
-			if(CN1(k) && ISE(k N)){mv[num++] = Board::getMove(k MN,k W ME);}
-		}
-		if(CE1(k) && ISO(k E) && GT(k,k E))
-		{
-			if(CS1(k) && ISE(k S)){mv[num++] = Board::getMove(k MS,k E MW);}
-			if(CW1(k) && ISE(k W)){mv[num++] = Board::getMove(k MW,k E MW);}
-			if(CN1(k) && ISE(k N)){mv[num++] = Board::getMove(k MN,k E MW);}
-		}
-		if(CN1(k) && ISO(k N) && GT(k,k N))
-		{
-			if(CS1(k) && ISE(k S)){mv[num++] = Board::getMove(k MS,k N MS);}
-			if(CW1(k) && ISE(k W)){mv[num++] = Board::getMove(k MW,k N MS);}
-			if(CE1(k) && ISE(k E)){mv[num++] = Board::getMove(k ME,k N MS);}
-		}
-	}
-	return num;
+  //Either way, the piece at k steps into an empty square, and then the piece beside it steps into k
+  int num = 0;
+  Bitmap mp;
+  if(ppS.hasBits())
+  {
+    mp = ppS & empW; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k MW,k S MN);}
+    mp = ppS & empE; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k ME,k S MN);}
+    mp = ppS & empN; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k MN,k S MN);}
+  }
+  if(ppW.hasBits())
+  {
+    mp = ppW & empS; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k MS,k W ME);}
+    mp = ppW & empE; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k ME,k W ME);}
+    mp = ppW & empN; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k MN,k W ME);}
+  }
+  if(ppE.hasBits())
+  {
+    mp = ppE & empS; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k MS,k E MW);}
+    mp = ppE & empW; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k MW,k E MW);}
+    mp = ppE & empN; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k MN,k E MW);}
+  }
+  if(ppN.hasBits())
+  {
+    mp = ppN & empS; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k MS,k N MS);}
+    mp = ppN & empW; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k MW,k N MS);}
+    mp = ppN & empE; while(mp.hasBits()) {loc_t k = mp.nextBit(); mv[num++] = Board::getMove(k ME,k N MS);}
+  }
+  return num;
 }
 
 bool BoardMoveGen::canPushPulls(const Board& b, pla_t pla)
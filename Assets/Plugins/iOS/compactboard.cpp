@@ -0,0 +1,177 @@
+/*
+ * compactboard.cpp
+ * Author: davidwu
+ */
+#include "pch.h"
+
+#include "global.h"
+#include "bitmap.h"
+#include "board.h"
+#include "compactboard.h"
+
+CompactBoard::CompactBoard()
+{
+	for(int i = 0; i<NUMTYPES-1; i++)
+	{
+		pieceMaps[0][i] = Bitmap();
+		pieceMaps[1][i] = Bitmap();
+	}
+	posStartHash = 0;
+	posCurrentHash = 0;
+	turnNumber = 0;
+	player = GOLD;
+	step = 0;
+}
+
+CompactBoard::CompactBoard(const Board& b)
+{
+	fromBoard(b);
+}
+
+void CompactBoard::fromBoard(const Board& b)
+{
+	for(int i = 0; i<NUMTYPES-1; i++)
+	{
+		pieceMaps[0][i] = b.pieceMaps[0][i+1];
+		pieceMaps[1][i] = b.pieceMaps[1][i+1];
+	}
+	posStartHash = b.posStartHash;
+	posCurrentHash = b.posCurrentHash;
+	turnNumber = b.turnNumber;
+	player = b.player;
+	step = b.step;
+}
+
+void CompactBoard::toBoard(Board& b) const
+{
+	for(int i = 0; i<64; i++)
+	{
+		b.owners[i] = NPLA;
+		b.pieces[i] = EMP;
+	}
+
+	for(pla_t pla = 0; pla <= 1; pla++)
+	{
+		Bitmap all;
+		for(piece_t piece = RAB; piece <= ELE; piece++)
+		{
+			Bitmap map = pieceMaps[pla][piece-1];
+			b.pieceMaps[pla][piece] = map;
+			b.pieceCounts[pla][piece] = map.countBits();
+			all |= map;
+			while(map.hasBits())
+			{
+				loc_t k = map.nextBit();
+				b.owners[k] = pla;
+				b.pieces[k] = piece;
+			}
+		}
+		b.pieceMaps[pla][EMP] = all;
+		b.pieceCounts[pla][EMP] = all.countBits();
+
+		for(int i = 0; i<4; i++)
+			b.trapGuardCounts[pla][i] = (all & Board::RADIUS[1][Board::TRAPLOCS[i]]).countBits();
+	}
+
+	b.player = player;
+	b.step = step;
+	b.turnNumber = turnNumber;
+	b.posStartHash = posStartHash;
+	b.posCurrentHash = posCurrentHash;
+	b.sitCurrentHash = getSitCurrentHash();
+	b.recalculateFreezeMap();
+}
+
+Board CompactBoard::toBoard() const
+{
+	Board b;
+	toBoard(b);
+	return b;
+}
+
+pla_t CompactBoard::ownerAt(loc_t k) const
+{
+	if(getPlaMap(GOLD).isOne(k)) return GOLD;
+	if(getPlaMap(SILV).isOne(k)) return SILV;
+	return NPLA;
+}
+
+piece_t CompactBoard::pieceAt(loc_t k) const
+{
+	for(int pla = 0; pla <= 1; pla++)
+		for(int i = 0; i<NUMTYPES-1; i++)
+			if(pieceMaps[pla][i].isOne(k))
+				return i+1;
+	return EMP;
+}
+
+void CompactBoard::makeStep(step_t s)
+{
+	//QPass step should do nothing
+	if(s == QPASSSTEP)
+		return;
+
+	if(step == 0)
+		posStartHash = posCurrentHash;
+
+	if(s == PASSSTEP || step == 3)
+	{
+		player = OPP(player);
+		step = 0;
+		turnNumber++;
+	}
+	else
+		step++;
+
+	if(s == PASSSTEP)
+		return;
+
+	loc_t k0 = Board::K0INDEX[s];
+	loc_t k1 = Board::K1INDEX[s];
+
+	//Find the moving piece
+	pla_t pla = NPLA;
+	int idx = 0;
+	for(int p = 0; p <= 1 && pla == NPLA; p++)
+		for(int i = 0; i<NUMTYPES-1; i++)
+			if(pieceMaps[p][i].isOne(k0))
+			{pla = p; idx = i; break;}
+	DEBUGASSERT(pla != NPLA);
+
+	pieceMaps[pla][idx] ^= Bitmap::makeLoc(k0) | Bitmap::makeLoc(k1);
+	hash_t hashDiff = Board::HASHPIECE[pla][idx+1][k0] ^ Board::HASHPIECE[pla][idx+1][k1];
+
+	//Only a piece of the stepping player on the trap it left can be captured
+	loc_t caploc = Board::ADJACENTTRAP[k0];
+	if(caploc != ERRORSQUARE)
+	{
+		Bitmap plaMap = getPlaMap(pla);
+		if(plaMap.isOne(caploc) && (plaMap & Board::RADIUS[1][caploc]).isEmpty())
+		{
+			for(int i = 0; i<NUMTYPES-1; i++)
+			{
+				if(pieceMaps[pla][i].isOne(caploc))
+				{
+					pieceMaps[pla][i].setOff(caploc);
+					hashDiff ^= Board::HASHPIECE[pla][i+1][caploc];
+					break;
+				}
+			}
+		}
+	}
+
+	posCurrentHash ^= hashDiff;
+}
+
+void CompactBoard::makeMove(move_t m)
+{
+	for(int i = 0; i<4; i++)
+	{
+		step_t s = Board::getStep(m,i);
+		if(s == ERRORSTEP || s == QPASSSTEP)
+			break;
+		makeStep(s);
+		if(s == PASSSTEP)
+			break;
+	}
+}
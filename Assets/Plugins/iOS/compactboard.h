@@ -0,0 +1,60 @@
+/*
+ * compactboard.h
+ * Author: davidwu
+ *
+ * A compact bitboard-only copy of a Board, for storing many positions or copying them often.
+ * Stores only the piece bitmaps, the player, step, turn number and position hashes, 120 bytes in total versus the
+ * 312 of a full Board, so it fits in two cache lines. The mailbox, counts, trap guarding, freezing and the situation
+ * hash are all derived on demand or rebuilt by toBoard.
+ *
+ * Supports making steps and moves directly, assuming legality, with the same resulting hashes as Board. Does not
+ * do any legality checking, since that needs freezing.
+ */
+
+#ifndef COMPACTBOARD_H
+#define COMPACTBOARD_H
+
+#include <stdint.h>
+#include "bitmap.h"
+#include "board.h"
+
+class CompactBoard
+{
+	public:
+
+	Bitmap pieceMaps[2][NUMTYPES-1]; //[pla][piece-1]: Bitmaps for each piece, no map for all pieces
+	hash_t posStartHash;    //As in Board
+	hash_t posCurrentHash;  //As in Board
+	int32_t turnNumber;     //As in Board
+	int8_t player;          //As in Board
+	int8_t step;            //As in Board
+
+	//Constructs an empty board, the same as Board()
+	CompactBoard();
+	//Constructs a compact copy of b
+	explicit CompactBoard(const Board& b);
+
+	//Set this to a compact copy of b
+	void fromBoard(const Board& b);
+	//Rebuild the full board, including counts, trap guarding and freezing. goalTreeMove is not stored and is left unset.
+	void toBoard(Board& b) const;
+	Board toBoard() const;
+
+	//Mailbox access, derived from the bitmaps
+	inline Bitmap getPlaMap(pla_t pla) const
+	{
+		const Bitmap* maps = pieceMaps[pla];
+		return maps[0] | maps[1] | maps[2] | maps[3] | maps[4] | maps[5];
+	}
+	pla_t ownerAt(loc_t k) const;
+	piece_t pieceAt(loc_t k) const;
+
+	inline hash_t getSitCurrentHash() const
+	{return posCurrentHash ^ Board::HASHPLA[player] ^ Board::HASHSTEP[step];}
+
+	//Make a step or move, assuming that it is legal, exactly as Board::makeStep and Board::makeMove do.
+	void makeStep(step_t s);
+	void makeMove(move_t m);
+};
+
+#endif
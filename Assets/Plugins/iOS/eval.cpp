@@ -125,7 +125,33 @@ eval_t Eval::evaluate(Board& b, eval_t alpha, eval_t beta, bool print)
 	return finalScore;
 }
 
+namespace Eval
+{
+	static eval_t evaluateWithParamsStaged(Board& b, pla_t mainPla, eval_t alpha, eval_t beta, const EvalParams& params, bool print,
+			bool allowLazy, eval_t& cheapScore, bool& isExact);
+}
+
 eval_t Eval::evaluateWithParams(Board& b, pla_t mainPla, eval_t alpha, eval_t beta, const EvalParams& params, bool print)
+{
+	bool isExact;
+	return evaluateWithParams(b,mainPla,alpha,beta,params,print,isExact);
+}
+
+eval_t Eval::evaluateWithParams(Board& b, pla_t mainPla, eval_t alpha, eval_t beta, const EvalParams& params, bool print, bool& isExact)
+{
+	//Never stop early when printing, we want to see everything
+	eval_t cheapScore;
+	return evaluateWithParamsStaged(b,mainPla,alpha,beta,params,print,!print,cheapScore,isExact);
+}
+
+void Eval::getStagedEvalWithParams(Board& b, pla_t mainPla, const EvalParams& params, eval_t& cheapScore, eval_t& fullScore)
+{
+	bool isExact;
+	fullScore = evaluateWithParamsStaged(b,mainPla,Eval::LOSE-1,Eval::WIN+1,params,false,false,cheapScore,isExact);
+}
+
+eval_t Eval::evaluateWithParamsStaged(Board& b, pla_t mainPla, eval_t alpha, eval_t beta, const EvalParams& params, bool print,
+		bool allowLazy, eval_t& cheapScore, bool& isExact)
 {
 	pla_t pla = b.player;
 	pla_t opp = OPP(pla);
@@ -182,6 +208,19 @@ eval_t Eval::evaluateWithParams(Board& b, pla_t mainPla, eval_t alpha, eval_t be
   int numSteps = 4-b.step;
   eval_t nsScore = SearchParams::STEPS_LEFT_BONUS[numSteps];
 
+  //Lazy exit----------------------------------------------------------------------------
+  //Everything after this point is expensive. If the cheap terms already put us far enough outside the window,
+  //return a bound instead.
+  cheapScore = (eval_t)(materialScore + psScore + nsScore + alignmentScore + tDefScore + tcScore + recklessScore);
+  isExact = true;
+  if(allowLazy)
+  {
+  	if(cheapScore + LAZY_MARGIN_ABOVE <= alpha)
+  	{isExact = false; return cheapScore + LAZY_MARGIN_ABOVE;}
+  	if(cheapScore - LAZY_MARGIN_BELOW >= beta)
+  	{isExact = false; return cheapScore - LAZY_MARGIN_BELOW;}
+  }
+
   //Piece threatening---------------------------------------------------------------------
   eval_t trapThreats[2][4];
   eval_t pieceThreats[64];
@@ -25,6 +25,11 @@ namespace Eval
 	const eval_t LOSE_TERMINAL = LOSE + 99999;   //Highest value that still is a loss
 	const eval_t WIN_TERMINAL = WIN - 99999;     //Lowest value that still is a win
 
+	//Lazy eval - how far the expensive terms of evaluateWithParams (threats, strats, sheriff, caps, rabbits)
+	//can move the score away from the cheap terms. Measured with evalLazyBounds, set a little past the 99.9th percentile.
+	const eval_t LAZY_MARGIN_ABOVE = 4600;
+	const eval_t LAZY_MARGIN_BELOW = 4200;
+
   /**
    * Evaluate the current board position and return the score.
    * @param b - the board
@@ -37,6 +42,16 @@ namespace Eval
 
   eval_t evaluateWithParams(Board& b, pla_t mainPla, eval_t alpha, eval_t beta, const EvalParams& params, bool print);
 
+  /**
+   * Staged version of evaluateWithParams. Computes the cheap terms first, and if they put the score far enough
+   * outside of [alpha,beta] that the expensive terms are very unlikely to bring it back, returns a bound instead.
+   * @param isExact - set to false if the return value is only a bound: <= alpha for an upper bound, >= beta for a lower
+   */
+  eval_t evaluateWithParams(Board& b, pla_t mainPla, eval_t alpha, eval_t beta, const EvalParams& params, bool print, bool& isExact);
+
+  //Compute both the cheap first stage and the full evaluation, never stopping early. For calibrating the lazy margins.
+  void getStagedEvalWithParams(Board& b, pla_t mainPla, const EvalParams& params, eval_t& cheapScore, eval_t& fullScore);
+
   //INITIALIZATION-------------------------------------------------------------------
 
   /**
@@ -9,6 +9,7 @@
 #include <fstream>
 #include <sstream>
 #include <cmath>
+#include <cstring>
 #include "global.h"
 #include "evalparams.h"
 #include "feature.h"
@@ -406,6 +407,20 @@ double EvalParams::get(fgrpindex_t group, int x) const
 	return featureWeights[fset.get(group, x)];
 }
 
+uint64_t EvalParams::getFingerprint() const
+{
+	uint64_t hash = 0x4E67C6A7F1B2D3C5ULL;
+	for(int i = 0; i<(int)featureWeights.size(); i++)
+	{
+		uint64_t bits;
+		memcpy(&bits,&featureWeights[i],sizeof(bits));
+		hash ^= bits;
+		hash *= 0xC849B09232AFC387ULL;
+		hash ^= hash >> 29;
+	}
+	return hash;
+}
+
 ostream& operator<<(ostream& out, const EvalParams& params)
 {
 	for(int i = 0; i<EvalParams::fset.numFeatures; i++)
@@ -51,6 +51,9 @@ class EvalParams
 	double get(fgrpindex_t group) const;
 	double get(fgrpindex_t group, int x) const;
 
+	//Hash of all the weights, so that cached evals from different params are never confused
+	uint64_t getFingerprint() const;
+
   friend ostream& operator<<(ostream& out, const EvalParams& params);
 };
 
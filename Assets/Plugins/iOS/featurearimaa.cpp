@@ -6,56 +6,61 @@
 #include "pch.h"
 
 #include <vector>
+#include "global.h"
 #include "bitmap.h"
 #include "board.h"
 #include "threats.h"
 #include "feature.h"
 #include "featurearimaa.h"
 
+void FeatureBuffer::overflow()
+{
+	Global::fatalError("FeatureBuffer: more than " + Global::intToString(CAPACITY) + " features for one move");
+}
+
 ArimaaFeatureSet::ArimaaFeatureSet()
-:fset(NULL),getFeaturesFunc(NULL),getPosDataFunc(NULL)
+:fset(NULL),getFeaturesFunc(NULL),getPosDataFunc(NULL),extractorName(""),extractorVersion(0)
 {}
 
-ArimaaFeatureSet::ArimaaFeatureSet(const FeatureSet* fset, GetFeaturesFunc getFeaturesFunc, GetPosDataFunc getPosDataFunc)
-:fset(fset),getFeaturesFunc(getFeaturesFunc),getPosDataFunc(getPosDataFunc)
+ArimaaFeatureSet::ArimaaFeatureSet(const FeatureSet* fset, GetFeaturesFunc getFeaturesFunc, GetPosDataFunc getPosDataFunc,
+		const char* extractorName, int extractorVersion)
+:fset(fset),getFeaturesFunc(getFeaturesFunc),getPosDataFunc(getPosDataFunc),
+ extractorName(extractorName),extractorVersion(extractorVersion)
 {}
 
-struct FeatureAccum
-{
-	const vector<double>* featureWeights;
-	double accum;
-
-	FeatureAccum(const vector<double>& featureWeights)
-	:featureWeights(&featureWeights),accum(0)
-	{}
-};
-static void addFeatureValue(findex_t feature, void* a)
+double ArimaaFeatureSet::getFeatureSum(const Board& b, const FeaturePosData& data,
+		pla_t pla, move_t move, const BoardHistory& hist, const vector<double>& featureWeights, FeatureBuffer& buf) const
 {
-	FeatureAccum* accum = (FeatureAccum*)a;
-	accum->accum += (*(accum->featureWeights))[feature];
-};
-
+	buf.clear();
+	getFeaturesFunc(b,data,pla,move,hist,buf);
+
+	const double* weights = featureWeights.data();
+	double accum = 0;
+	for(int i = 0; i<buf.numFeatures; i++)
+		accum += weights[buf.features[i]];
+	return accum;
+}
 
 double ArimaaFeatureSet::getFeatureSum(const Board& b, const FeaturePosData& data,
 		pla_t pla, move_t move, const BoardHistory& hist, const vector<double>& featureWeights) const
 {
-	FeatureAccum accum(featureWeights);
-	getFeaturesFunc(b,data,pla,move,hist,&addFeatureValue,&accum);
-	return accum.accum;
+	FeatureBuffer buf;
+	return getFeatureSum(b,data,pla,move,hist,featureWeights,buf);
 }
 
-static void addFeatureToVector(findex_t x, void* v)
+void ArimaaFeatureSet::getFeatures(const Board& b, const FeaturePosData& data,
+		pla_t pla, move_t move, const BoardHistory& hist, FeatureBuffer& buf) const
 {
-	vector<findex_t>* vec = (vector<findex_t>*)v;
-	vec->push_back(x);
+	buf.clear();
+	getFeaturesFunc(b,data,pla,move,hist,buf);
 }
 
 vector<findex_t> ArimaaFeatureSet::getFeatures(const Board& b, const FeaturePosData& data,
 		pla_t pla, move_t move, const BoardHistory& hist) const
 {
-	vector<findex_t> featuresVec;
-	getFeaturesFunc(b,data,pla,move,hist,&addFeatureToVector,&featuresVec);
-  return featuresVec;
+	FeatureBuffer buf;
+	getFeatures(b,data,pla,move,hist,buf);
+	return vector<findex_t>(buf.features,buf.features+buf.numFeatures);
 }
 
 
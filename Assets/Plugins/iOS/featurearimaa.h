@@ -12,7 +12,36 @@
 #include "feature.h"
 
 struct FeaturePosData; //In featuremove.h
-typedef void (*GetFeaturesFunc)(const Board& b, const FeaturePosData&, pla_t, move_t, const BoardHistory&, void (*handleFeature)(findex_t,void*), void*);
+
+//Fixed capacity buffer that feature extraction appends the features of a move to, so that extracting them
+//never allocates. Reusable across moves via clear().
+struct FeatureBuffer
+{
+	static const int CAPACITY = 512;
+
+	int numFeatures;
+	findex_t features[CAPACITY];
+
+	FeatureBuffer()
+	:numFeatures(0)
+	{}
+
+	inline void clear()
+	{numFeatures = 0;}
+
+	//Checked even in release builds, since CAPACITY is only a measured bound on the features of a move
+	inline void add(findex_t feature)
+	{
+		if(numFeatures >= CAPACITY)
+			overflow();
+		features[numFeatures++] = feature;
+	}
+
+	private:
+	static void overflow();
+};
+
+typedef void (*GetFeaturesFunc)(const Board& b, const FeaturePosData&, pla_t, move_t, const BoardHistory&, FeatureBuffer&);
 typedef void (*GetPosDataFunc)(const Board& b, const BoardHistory& hist, pla_t pla, FeaturePosData& data);
 
 struct ArimaaFeatureSet
@@ -21,12 +50,23 @@ struct ArimaaFeatureSet
 	GetFeaturesFunc getFeaturesFunc;
 	GetPosDataFunc getPosDataFunc;
 
+	//Identify the extraction code, so that anything saved from its output (ex: FeatureCache) can tell when it is stale
+	const char* extractorName;
+	int extractorVersion;
+
 	ArimaaFeatureSet();
-	ArimaaFeatureSet(const FeatureSet* fset, GetFeaturesFunc getFeaturesFunc, GetPosDataFunc getPosDataFunc);
+	ArimaaFeatureSet(const FeatureSet* fset, GetFeaturesFunc getFeaturesFunc, GetPosDataFunc getPosDataFunc,
+			const char* extractorName = "", int extractorVersion = 0);
 
+  //Sum of the weights of the features of the move, using buf as scratch space
+  double getFeatureSum(const Board& b, const FeaturePosData& data,
+  		pla_t pla, move_t move, const BoardHistory& hist, const vector<double>& featureWeights, FeatureBuffer& buf) const;
   double getFeatureSum(const Board& b, const FeaturePosData& data,
   		pla_t pla, move_t move, const BoardHistory& hist, const vector<double>& featureWeights) const;
 
+  //Clears buf and fills it with the features of the move
+  void getFeatures(const Board& b, const FeaturePosData& data,
+  		pla_t pla, move_t move, const BoardHistory& hist, FeatureBuffer& buf) const;
   vector<findex_t> getFeatures(const Board& b, const FeaturePosData& data,
   		pla_t pla, move_t move, const BoardHistory& hist) const;
 
@@ -0,0 +1,352 @@
+/*
+ * featurecache.cpp
+ * Author: davidwu
+ */
+#include "pch.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <vector>
+#include "global.h"
+#include "timer.h"
+#include "gameiterator.h"
+#include "mappedfile.h"
+#include "featurecache.h"
+
+using namespace std;
+
+static const char MAGIC[8] = {'A','R','F','C','A','C','H','E'};
+static const int NUM_KEY_FIELDS = 11;
+static const int HEADER_SIZE = 8 + 4 + 4 + 8*NUM_KEY_FIELDS + 8 + 8;
+static const int COMPLETE_OFFSET = 12;
+
+//ENCODING-------------------------------------------------------------------
+
+static void writeFixed(vector<uint8_t>& bytes, uint64_t x, int numBytes)
+{
+	for(int i = 0; i<numBytes; i++)
+		bytes.push_back((uint8_t)(x >> (8*i)));
+}
+
+static uint64_t readFixed(const uint8_t* bytes, int numBytes)
+{
+	uint64_t x = 0;
+	for(int i = 0; i<numBytes; i++)
+		x |= (uint64_t)bytes[i] << (8*i);
+	return x;
+}
+
+//Same as MTDByteStream, 7 bits per byte with the most significant group first and the top bit set on all but the last
+static void writeUInt(vector<uint8_t>& bytes, uint32_t x)
+{
+	int numNewBytes = 0;
+	uint8_t newBytes[5];
+
+	do
+	{
+		newBytes[numNewBytes++] = x & 0x7F;
+		x = x >> 7;
+	} while(x > 0);
+
+	for(int i = numNewBytes-1; i > 0; i--)
+		bytes.push_back(newBytes[i] | 0x80);
+	bytes.push_back(newBytes[0]);
+}
+
+static inline uint32_t readUInt(const uint8_t*& ptr, const uint8_t* end)
+{
+	uint32_t value = 0;
+	bool hasNext = true;
+	while(hasNext)
+	{
+		if(ptr >= end)
+			Global::fatalError("FeatureCache: truncated file");
+		uint8_t byte = *(ptr++);
+		hasNext = ((byte & 0x80) != 0);
+		value = value * 128 + (byte & 0x7F);
+	}
+	return value;
+}
+
+static inline uint32_t zigzag(int32_t x)
+{
+	return ((uint32_t)x << 1) ^ (uint32_t)(x >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t x)
+{
+	return (int32_t)(x >> 1) ^ -(int32_t)(x & 1);
+}
+
+void FeatureCache::encodeMatches(const FeatureMatches& block, vector<uint8_t>& bytes)
+{
+	int numMatches = block.numMatches();
+	writeUInt(bytes,numMatches);
+	for(int m = 0; m<numMatches; m++)
+	{
+		int numTeams = block.numTeams(m);
+		int teamStart = block.matchTeamStart[m];
+		writeUInt(bytes,numTeams);
+		writeUInt(bytes,block.winners[m]);
+		for(int t = 0; t<numTeams; t++)
+		{
+			int fStart = block.teamFeatureStart[teamStart+t];
+			int fEnd = block.teamFeatureStart[teamStart+t+1];
+			writeUInt(bytes,fEnd-fStart);
+			findex_t prev = 0;
+			for(int i = fStart; i<fEnd; i++)
+			{
+				writeUInt(bytes,zigzag(block.features[i] - prev));
+				prev = block.features[i];
+			}
+		}
+	}
+}
+
+const uint8_t* FeatureCache::decodeMatches(const uint8_t* ptr, const uint8_t* end, int numFeatures, FeatureBuffer& buf,
+		FeatureMatches& block)
+{
+	block.clear();
+	int numMatches = readUInt(ptr,end);
+	for(int m = 0; m<numMatches; m++)
+	{
+		int numTeams = readUInt(ptr,end);
+		int winner = readUInt(ptr,end);
+		if(winner >= numTeams)
+			Global::fatalError("FeatureCache: invalid winning team");
+		block.beginMatch(winner);
+		for(int t = 0; t<numTeams; t++)
+		{
+			int teamSize = readUInt(ptr,end);
+			if(teamSize > FeatureBuffer::CAPACITY)
+				Global::fatalError("FeatureCache: team has too many features");
+			findex_t prev = 0;
+			for(int i = 0; i<teamSize; i++)
+			{
+				prev += unzigzag(readUInt(ptr,end));
+				if(prev < 0 || prev >= numFeatures)
+					Global::fatalError("FeatureCache: invalid feature");
+				buf.features[i] = prev;
+			}
+			block.addTeam(buf.features,teamSize);
+		}
+	}
+	return ptr;
+}
+
+//KEYS-----------------------------------------------------------------------
+
+static uint64_t hashBytes(const char* data, uint64_t size)
+{
+	uint64_t h = 0x9E3779B97F4A7C15ULL ^ size;
+	uint64_t i = 0;
+	for(; i+8 <= size; i += 8)
+	{
+		uint64_t x;
+		memcpy(&x,data+i,8);
+		h = (h ^ x) * 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 32;
+	}
+	for(; i < size; i++)
+	{
+		h = (h ^ (uint8_t)data[i]) * 0xC4CEB9FE1A85EC53ULL;
+		h ^= h >> 32;
+	}
+	return h;
+}
+
+static uint64_t doubleBits(double d)
+{
+	uint64_t x;
+	memcpy(&x,&d,8);
+	return x;
+}
+
+bool FeatureCache::Key::operator==(const Key& other) const
+{
+	return featureSetHash == other.featureSetHash && numFeatures == other.numFeatures &&
+			extractorHash == other.extractorHash && extractorVersion == other.extractorVersion &&
+			gamesFileSize == other.gamesFileSize && gamesFileHash == other.gamesFileHash &&
+			moveType == other.moveType && doFiltering == other.doFiltering &&
+			gameKeepPropBits == other.gameKeepPropBits && moveKeepPropBits == other.moveKeepPropBits &&
+			moveKeepThreshold == other.moveKeepThreshold;
+}
+
+bool FeatureCache::Key::operator!=(const Key& other) const
+{
+	return !(*this == other);
+}
+
+static uint64_t getFeatureSetHash(ArimaaFeatureSet afset)
+{
+	string names;
+	int numFeatures = afset.fset->numFeatures;
+	for(int i = 0; i<numFeatures; i++)
+		names += afset.fset->getName(i) + "\n";
+	return Global::getHash(names.c_str());
+}
+
+FeatureCache::Key FeatureCache::getKey(ArimaaFeatureSet afset, const string& gamesFile, int moveType, bool doFiltering)
+{
+	MappedFile games;
+	games.open(gamesFile);
+
+	Key key;
+	key.featureSetHash = getFeatureSetHash(afset);
+	key.numFeatures = afset.fset->numFeatures;
+	key.extractorHash = Global::getHash(afset.extractorName);
+	key.extractorVersion = afset.extractorVersion;
+	key.gamesFileSize = games.size();
+	key.gamesFileHash = hashBytes(games.data(),games.size());
+	key.moveType = moveType;
+	key.doFiltering = doFiltering;
+	key.gameKeepPropBits = doubleBits(GameIterator::GAME_KEEP_PROP);
+	key.moveKeepPropBits = doubleBits(GameIterator::MOVE_KEEP_PROP);
+	key.moveKeepThreshold = GameIterator::MOVE_KEEP_THRESHOLD;
+	return key;
+}
+
+//HEADER---------------------------------------------------------------------
+
+void FeatureCache::writeHeader(vector<uint8_t>& bytes, const Header& header)
+{
+	bytes.insert(bytes.end(),MAGIC,MAGIC+8);
+	writeFixed(bytes,header.version,4);
+	writeFixed(bytes,header.complete ? 1 : 0,4);
+	const FeatureCache::Key& key = header.key;
+	uint64_t fields[NUM_KEY_FIELDS] = {key.featureSetHash, key.numFeatures, key.extractorHash, key.extractorVersion,
+			key.gamesFileSize, key.gamesFileHash, key.moveType, key.doFiltering, key.gameKeepPropBits, key.moveKeepPropBits, key.moveKeepThreshold};
+	for(int i = 0; i<NUM_KEY_FIELDS; i++)
+		writeFixed(bytes,fields[i],8);
+	writeFixed(bytes,header.numGames,8);
+	writeFixed(bytes,header.numMatches,8);
+	DEBUGASSERT(bytes.size() == HEADER_SIZE);
+}
+
+//Returns false if the data is too short or does not start with the magic bytes
+static bool readHeader(const char* data, uint64_t size, FeatureCache::Header& header)
+{
+	if(size < HEADER_SIZE || memcmp(data,MAGIC,8) != 0)
+		return false;
+	const uint8_t* bytes = (const uint8_t*)data;
+	header.version = readFixed(bytes+8,4);
+	header.complete = readFixed(bytes+COMPLETE_OFFSET,4) == 1;
+	uint64_t fields[NUM_KEY_FIELDS];
+	for(int i = 0; i<NUM_KEY_FIELDS; i++)
+		fields[i] = readFixed(bytes+16+8*i,8);
+	FeatureCache::Key& key = header.key;
+	key.featureSetHash = fields[0];
+	key.numFeatures = fields[1];
+	key.extractorHash = fields[2];
+	key.extractorVersion = fields[3];
+	key.gamesFileSize = fields[4];
+	key.gamesFileHash = fields[5];
+	key.moveType = fields[6];
+	key.doFiltering = fields[7];
+	key.gameKeepPropBits = fields[8];
+	key.moveKeepPropBits = fields[9];
+	key.moveKeepThreshold = fields[10];
+	header.numGames = readFixed(bytes+16+8*NUM_KEY_FIELDS,8);
+	header.numMatches = readFixed(bytes+24+8*NUM_KEY_FIELDS,8);
+	return true;
+}
+
+//BUILDING AND READING-------------------------------------------------------
+
+void FeatureCache::build(ArimaaFeatureSet afset, const string& gamesFile, int moveType, bool doFiltering, int numThreads,
+		const string& cacheFile)
+{
+	ClockTimer timer;
+	Header header;
+	header.version = VERSION;
+	header.complete = false;
+	header.key = getKey(afset,gamesFile,moveType,doFiltering);
+	header.numGames = 0;
+	header.numMatches = 0;
+
+	ofstream out(cacheFile.c_str(), ios::out | ios::binary | ios::trunc);
+	if(out.fail())
+		Global::fatalError("FeatureCache: could not open file for writing: " + cacheFile);
+
+	vector<uint8_t> bytes;
+	writeHeader(bytes,header);
+	out.write((const char*)bytes.data(),bytes.size());
+
+	GameIterator iter(gamesFile.c_str(),moveType,doFiltering);
+	iter.computeAllMoveFeatures(afset,numThreads,[&](const FeatureMatches& block) {
+		bytes.clear();
+		encodeMatches(block,bytes);
+		out.write((const char*)bytes.data(),bytes.size());
+		header.numGames++;
+		header.numMatches += block.numMatches();
+	});
+
+	//Now that everything is written, fill in the counts and mark it complete
+	header.complete = true;
+	bytes.clear();
+	writeHeader(bytes,header);
+	out.seekp(0,ios::beg);
+	out.write((const char*)bytes.data(),bytes.size());
+	out.close();
+	if(out.fail())
+		Global::fatalError("FeatureCache: error writing file: " + cacheFile);
+
+	cout << "FeatureCache: wrote " << header.numMatches << " matches from " << header.numGames << " games to "
+			<< cacheFile << " in " << timer.getSeconds() << "s" << endl;
+}
+
+bool FeatureCache::isUpToDate(const string& cacheFile, const Key& key)
+{
+	ifstream in(cacheFile.c_str(), ios::in | ios::binary);
+	if(in.fail())
+		return false;
+	char data[HEADER_SIZE];
+	in.read(data,HEADER_SIZE);
+	if(in.gcount() != HEADER_SIZE)
+		return false;
+
+	Header header;
+	if(!readHeader(data,HEADER_SIZE,header))
+		return false;
+	return header.version == VERSION && header.complete && header.key == key;
+}
+
+bool FeatureCache::refresh(ArimaaFeatureSet afset, const string& gamesFile, int moveType, bool doFiltering, int numThreads,
+		const string& cacheFile)
+{
+	if(isUpToDate(cacheFile,getKey(afset,gamesFile,moveType,doFiltering)))
+		return false;
+	build(afset,gamesFile,moveType,doFiltering,numThreads,cacheFile);
+	return true;
+}
+
+void FeatureCache::read(const string& cacheFile, ArimaaFeatureSet afset, const function<void(const FeatureMatches&)>& consume)
+{
+	MappedFile file;
+	file.open(cacheFile);
+
+	Header header;
+	if(!readHeader(file.data(),file.size(),header))
+		Global::fatalError("FeatureCache: not a feature cache: " + cacheFile);
+	if(header.version != VERSION)
+		Global::fatalError("FeatureCache: wrong version " + Global::intToString(header.version) + ": " + cacheFile);
+	if(!header.complete)
+		Global::fatalError("FeatureCache: incomplete file: " + cacheFile);
+	if(header.key.featureSetHash != getFeatureSetHash(afset) || header.key.numFeatures != (uint64_t)afset.fset->numFeatures)
+		Global::fatalError("FeatureCache: built for a different feature set: " + cacheFile);
+	if(header.key.extractorHash != Global::getHash(afset.extractorName) || header.key.extractorVersion != (uint64_t)afset.extractorVersion)
+		Global::fatalError("FeatureCache: built with a different feature extractor or extractor version: " + cacheFile);
+
+	const uint8_t* ptr = (const uint8_t*)file.data() + HEADER_SIZE;
+	const uint8_t* end = (const uint8_t*)file.data() + file.size();
+	FeatureBuffer buf;
+	FeatureMatches block;
+	for(uint64_t g = 0; g<header.numGames; g++)
+	{
+		ptr = decodeMatches(ptr,end,afset.fset->numFeatures,buf,block);
+		consume(block);
+	}
+	if(ptr != end)
+		Global::fatalError("FeatureCache: unexpected data at end of file: " + cacheFile);
+}
@@ -0,0 +1,91 @@
+
+/*
+ * featurecache.h
+ * Author: davidwu
+ *
+ * A binary file of the feature matches extracted from a games file, so that training runs on the same games
+ * and feature set can skip parsing, replaying, move generation and feature computation entirely.
+ *
+ * Format (version 2), all fixed width integers little endian:
+ *   Header: the magic bytes "ARFCACHE", a uint32 version, a uint32 flag that is 1 once the file is completely
+ *   written, then the uint64 fields of FeatureCache::Key followed by the uint64 numbers of games and matches.
+ *   Body: for each game, in order, numMatches, then for each match numTeams and the winning team, then for each
+ *   team numFeatures followed by the features, each as the zigzag encoded difference from the previous feature in
+ *   the team (or from 0). All of these are variable length integers in the same encoding as MTDByteStream.
+ *
+ * The file is memory mapped for reading.
+ */
+
+#ifndef FEATURECACHE_H_
+#define FEATURECACHE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include "featurearimaa.h"
+#include "gameiterator.h"
+
+using namespace std;
+
+namespace FeatureCache
+{
+	const uint32_t VERSION = 2;
+
+	//Identifies everything that the extracted matches depend on, so that a stale cache can be detected
+	struct Key
+	{
+		uint64_t featureSetHash;   //Hash of the names of all the features
+		uint64_t numFeatures;
+		uint64_t extractorHash;    //Hash of ArimaaFeatureSet::extractorName
+		uint64_t extractorVersion; //ArimaaFeatureSet::extractorVersion
+		uint64_t gamesFileSize;
+		uint64_t gamesFileHash;    //Hash of the contents of the games file
+		uint64_t moveType;         //As in GameIterator
+		uint64_t doFiltering;
+		uint64_t gameKeepPropBits; //Bits of GameIterator::GAME_KEEP_PROP
+		uint64_t moveKeepPropBits; //Bits of GameIterator::MOVE_KEEP_PROP
+		uint64_t moveKeepThreshold;
+
+		bool operator==(const Key& other) const;
+		bool operator!=(const Key& other) const;
+	};
+
+	Key getKey(ArimaaFeatureSet afset, const string& gamesFile, int moveType, bool doFiltering);
+
+	struct Header
+	{
+		uint32_t version;
+		bool complete;
+		Key key;
+		uint64_t numGames;
+		uint64_t numMatches;
+	};
+
+	//Extract the feature matches of every position of every game in gamesFile using numThreads threads, and write them
+	//to cacheFile. The file is only marked complete at the end, so an interrupted build never looks valid.
+	void build(ArimaaFeatureSet afset, const string& gamesFile, int moveType, bool doFiltering, int numThreads,
+			const string& cacheFile);
+
+	//Is cacheFile a complete cache built with the given key?
+	bool isUpToDate(const string& cacheFile, const Key& key);
+
+	//Build cacheFile unless it is already up to date. Returns true if it was (re)built.
+	bool refresh(ArimaaFeatureSet afset, const string& gamesFile, int moveType, bool doFiltering, int numThreads,
+			const string& cacheFile);
+
+	//Decode cacheFile, calling consume with the matches of each game in order of games.
+	//Fatal error if the file is incomplete, has the wrong version, or was built for a different feature set or extractor.
+	void read(const string& cacheFile, ArimaaFeatureSet afset, const function<void(const FeatureMatches&)>& consume);
+
+	//Encoding of the parts of the file, exposed for testing-------------------
+	void writeHeader(vector<uint8_t>& bytes, const Header& header);
+	//Append the body of one game's matches
+	void encodeMatches(const FeatureMatches& block, vector<uint8_t>& bytes);
+	//Decode one game's matches into block, using buf as scratch. Returns the end of what was read.
+	//Fatal error if the data is truncated or invalid for a feature set with numFeatures features.
+	const uint8_t* decodeMatches(const uint8_t* ptr, const uint8_t* end, int numFeatures, FeatureBuffer& buf,
+			FeatureMatches& block);
+}
+
+#endif /* FEATURECACHE_H_ */
@@ -249,7 +249,8 @@ const FeatureSet& MoveFeature::getFeatureSet()
 
 ArimaaFeatureSet MoveFeature::getArimaaFeatureSet()
 {
-	return ArimaaFeatureSet(&fset,MoveFeature::getFeatures,MoveFeature::getPosData);
+	return ArimaaFeatureSet(&fset,MoveFeature::getFeatures,MoveFeature::getPosData,
+			"MoveFeature",MoveFeature::EXTRACTOR_VERSION);
 }
 
 bool MoveFeature::IS_INITIALIZED = false;
@@ -567,12 +568,12 @@ static void initPriors()
 
 
 void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla_t pla, move_t move, const BoardHistory& hist,
-		void (*handleFeature)(findex_t,void*), void* handleFeatureData)
+		FeatureBuffer& features)
 {
   //Handle Pass Move
   if(move == PASSMOVE || move == QPASSMOVE)
   {
-    (*handleFeature)(fset.get(PASS),handleFeatureData);
+    features.add(fset.get(PASS));
     return;
   }
 
@@ -598,13 +599,13 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
       if(owner == pla) {srcFeature = SRC; destFeature = DEST;}
       else             {srcFeature = SRC_O; destFeature = DEST_O;}
 
-      (*handleFeature)(fset.get(srcFeature,pieceIndex,Board::SYMLOC[pla][src[i]]),handleFeatureData);
-      (*handleFeature)(fset.get(destFeature,pieceIndex,(dest[i] == ERRORSQUARE) ? 32 : Board::SYMLOC[pla][dest[i]]),handleFeatureData);
+      features.add(fset.get(srcFeature,pieceIndex,Board::SYMLOC[pla][src[i]]));
+      features.add(fset.get(destFeature,pieceIndex,(dest[i] == ERRORSQUARE) ? 32 : Board::SYMLOC[pla][dest[i]]));
     }
 
     if(ENABLE_CAPTURED && (dest[i] == ERRORSQUARE))
     {
-      (*handleFeature)(fset.get(owner == pla ? CAPTURED : CAPTURED_O,pieceIndex),handleFeatureData);
+      features.add(fset.get(owner == pla ? CAPTURED : CAPTURED_O,pieceIndex));
     }
 
     //FRAMESAC features
@@ -613,7 +614,7 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
       if(dest[i] == ERRORSQUARE && owner == pla && Board::ISTRAP[src[i]] && data.oppHoldsFrameAtTrap[Board::TRAPINDEX[src[i]]])
       {
       	bool isEleEle = data.oppFrameIsEleEle[Board::TRAPINDEX[src[i]]];
-      	(*handleFeature)(fset.get(FRAMESAC,pieceIndex,isEleEle),handleFeatureData);
+      	features.add(fset.get(FRAMESAC,pieceIndex,isEleEle));
       }
     }
   }
@@ -633,9 +634,9 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 			int symDir = getSymDir(pla,k0,k1);
 			int pieceIndex = data.pieceIndex[bb.owners[k0]][bb.pieces[k0]];
 			if(bb.owners[k0] == pla)
-				(*handleFeature)(fset.get(ACTUAL_STEP,pieceIndex,symDir*32 + symLoc),handleFeatureData);
+				features.add(fset.get(ACTUAL_STEP,pieceIndex,symDir*32 + symLoc));
 			else
-				(*handleFeature)(fset.get(ACTUAL_STEP_O,pieceIndex,symDir*32 + symLoc),handleFeatureData);
+				features.add(fset.get(ACTUAL_STEP_O,pieceIndex,symDir*32 + symLoc));
 
 			bb.makeStep(s);
 
@@ -656,13 +657,13 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 			{
 				bool isEleEle = (Board::RADIUS[1][trap] & b.pieceMaps[0][ELE]).hasBits() &&
 					              (Board::RADIUS[1][trap] & b.pieceMaps[1][ELE]).hasBits();
-				(*handleFeature)(fset.get(FRAME_P,data.pieceIndex[pla][copy.pieces[trap]],isEleEle),handleFeatureData);
+				features.add(fset.get(FRAME_P,data.pieceIndex[pla][copy.pieces[trap]],isEleEle));
 			}
 			else if(Strats::findFrame(copy,opp,trap,&ft))
 			{
 				bool isEleEle = (Board::RADIUS[1][trap] & b.pieceMaps[0][ELE]).hasBits() &&
 					              (Board::RADIUS[1][trap] & b.pieceMaps[1][ELE]).hasBits();
-				(*handleFeature)(fset.get(FRAME_O,data.pieceIndex[opp][copy.pieces[trap]],isEleEle),handleFeatureData);
+				features.add(fset.get(FRAME_O,data.pieceIndex[opp][copy.pieces[trap]],isEleEle));
 			}
   	}
 
@@ -672,8 +673,8 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   		int centrality = Board::CENTRALITY[bt.pinnedLoc];
   		int gydist = Board::GOALYDIST[pla][bt.pinnedLoc];
   		bool usesEle = (bt.holderMap & copy.pieceMaps[pla][ELE]).hasBits();
-  		(*handleFeature)(fset.get(EBLOCKADE_CENT_P,centrality,usesEle),handleFeatureData);
-  		(*handleFeature)(fset.get(EBLOCKADE_GYDIST_P,gydist,usesEle),handleFeatureData);
+  		features.add(fset.get(EBLOCKADE_CENT_P,centrality,usesEle));
+  		features.add(fset.get(EBLOCKADE_GYDIST_P,gydist,usesEle));
   	}
   	bt = BlockadeThreat();
   	if(Strats::findBlockades(copy,opp,&bt))
@@ -681,8 +682,8 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   		int centrality = Board::CENTRALITY[bt.pinnedLoc];
   		int gydist = Board::GOALYDIST[opp][bt.pinnedLoc];
   		bool usesEle = (bt.holderMap & copy.pieceMaps[opp][ELE]).hasBits();
-  		(*handleFeature)(fset.get(EBLOCKADE_CENT_O,centrality,usesEle),handleFeatureData);
-  		(*handleFeature)(fset.get(EBLOCKADE_GYDIST_O,gydist,usesEle),handleFeatureData);
+  		features.add(fset.get(EBLOCKADE_CENT_O,centrality,usesEle));
+  		features.add(fset.get(EBLOCKADE_GYDIST_O,gydist,usesEle));
   	}
 	}
 
@@ -699,10 +700,10 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
       int newOppTrapState = ArimaaFeature::getTrapState(copy,opp,kt);
 
       if(oldPlaTrapState != newPlaTrapState)
-      	(*handleFeature)(fset.get(TRAP_STATE_P,isOppTrap,oldPlaTrapState,newPlaTrapState),handleFeatureData);
+      	features.add(fset.get(TRAP_STATE_P,isOppTrap,oldPlaTrapState,newPlaTrapState));
 
       if(oldOppTrapState != newOppTrapState)
-      	(*handleFeature)(fset.get(TRAP_STATE_O,isOppTrap,oldOppTrapState,newOppTrapState),handleFeatureData);
+      	features.add(fset.get(TRAP_STATE_O,isOppTrap,oldOppTrapState,newOppTrapState));
     }
   }
 
@@ -726,7 +727,7 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   		if(val < 0) val = 0;
   		else if(val > 16) val = 16;
 
-  		(*handleFeature)(fset.get(TRAP_CONTROL,isOppTrap,val),handleFeatureData);
+  		features.add(fset.get(TRAP_CONTROL,isOppTrap,val));
   	}
   }
 
@@ -744,19 +745,19 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   		int isOppTrap = !Board::ISPLATRAP[trapIndex][pla];
 
       if(plaEleLoc != ERRORSQUARE && Board::ISADJACENT[plaEleLoc][kt])
-      	(*handleFeature)(fset.get(CAP_DEF_ELEDEF,isOppTrap,dist),handleFeatureData);
+      	features.add(fset.get(CAP_DEF_ELEDEF,isOppTrap,dist));
       else if(copy.trapGuardCounts[pla][trapIndex] > b.trapGuardCounts[pla][trapIndex])
-      	(*handleFeature)(fset.get(CAP_DEF_TRAPDEF,isOppTrap,dist),handleFeatureData);
+      	features.add(fset.get(CAP_DEF_TRAPDEF,isOppTrap,dist));
       else
       {
         for(int i = 0; i<numChanges; i++)
         {
           if(src[i] == data.oppCapThreats[j].oloc && dest[i] != ERRORSQUARE)
-          	(*handleFeature)(fset.get(CAP_DEF_RUNAWAY,isOppTrap,dist),handleFeatureData);
+          	features.add(fset.get(CAP_DEF_RUNAWAY,isOppTrap,dist));
           else if(data.oppCapThreats[j].ploc != ERRORSQUARE && src[i] == data.oppCapThreats[j].ploc && dest[i] != ERRORSQUARE)
-          	(*handleFeature)(fset.get(CAP_DEF_INTERFERE,isOppTrap,dist),handleFeatureData);
+          	features.add(fset.get(CAP_DEF_INTERFERE,isOppTrap,dist));
           else if(data.oppCapThreats[j].ploc != ERRORSQUARE && b.isThawed(data.oppCapThreats[j].ploc) && copy.isFrozen(data.oppCapThreats[j].ploc))
-          	(*handleFeature)(fset.get(CAP_DEF_INTERFERE,isOppTrap,dist),handleFeatureData);
+          	features.add(fset.get(CAP_DEF_INTERFERE,isOppTrap,dist));
         }
       }
     }
@@ -765,16 +766,16 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   if(ENABLE_GOAL_THREAT)
   {
     if(copy.getWinner() == pla)
-    	(*handleFeature)(fset.get(WINS_GAME),handleFeatureData);
+    	features.add(fset.get(WINS_GAME));
 
     int newPlaGoalDist = BoardTrees::goalDist(copy,pla,4);
     int newOppGoalDist = BoardTrees::goalDist(copy,opp,4);
 
     if(newPlaGoalDist < data.plaGoalDist && newPlaGoalDist <= 4 && newPlaGoalDist > 0)
-    	(*handleFeature)(fset.get(THREATENS_GOAL,newPlaGoalDist),handleFeatureData);
+    	features.add(fset.get(THREATENS_GOAL,newPlaGoalDist));
 
     if(newOppGoalDist <= 4)
-    	(*handleFeature)(fset.get(ALLOWS_GOAL),handleFeatureData);
+    	features.add(fset.get(ALLOWS_GOAL));
   }
 
   //Where was the piece at this location prior to this move?
@@ -818,7 +819,7 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 
         //If it wasn't already been threatened, add it!
         if(!data.plaCapMap.isOne(priorLocation[biggestLoc]))
-        	(*handleFeature)(fset.get(THREATENS_CAP,data.pieceIndex[opp][biggestPiece],capDist,isOppTrap),handleFeatureData);
+        	features.add(fset.get(THREATENS_CAP,data.pieceIndex[opp][biggestPiece],capDist,isOppTrap));
       }
     }
     //Check for opponent capture threats around each trap
@@ -854,9 +855,9 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 
           //Was not moved
           if(priorLocation[biggestLoc] == biggestLoc)
-          	(*handleFeature)(fset.get(INVITES_CAP_UNMOVED,data.pieceIndex[pla][biggestPiece],capDist,isOppTrap),handleFeatureData);
+          	features.add(fset.get(INVITES_CAP_UNMOVED,data.pieceIndex[pla][biggestPiece],capDist,isOppTrap));
           else
-          	(*handleFeature)(fset.get(INVITES_CAP_MOVED,data.pieceIndex[pla][biggestPiece],capDist,isOppTrap),handleFeatureData);
+          	features.add(fset.get(INVITES_CAP_MOVED,data.pieceIndex[pla][biggestPiece],capDist,isOppTrap));
         }
       }
     }
@@ -869,7 +870,7 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
     while(preventedMap.hasBits())
     {
       loc_t loc = preventedMap.nextBit();
-      (*handleFeature)(fset.get(PREVENTS_CAP,data.pieceIndex[pla][b.pieces[loc]],Board::SYMLOC[pla][loc]),handleFeatureData);
+      features.add(fset.get(PREVENTS_CAP,data.pieceIndex[pla][b.pieces[loc]],Board::SYMLOC[pla][loc]));
     }
 
   }
@@ -882,13 +883,13 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   		loc_t loc = oppMap.nextBit();
   		if(b.owners[loc] == opp && b.isFrozen(loc))
   		{
-  			(*handleFeature)(fset.get(THAWS_OPP_STR,data.pieceIndex[opp][b.pieces[loc]]),handleFeatureData);
-  			(*handleFeature)(fset.get(THAWS_OPP_AT,Board::SYMLOC[opp][loc]),handleFeatureData);
+  			features.add(fset.get(THAWS_OPP_STR,data.pieceIndex[opp][b.pieces[loc]]));
+  			features.add(fset.get(THAWS_OPP_AT,Board::SYMLOC[opp][loc]));
   		}
   		else
   		{
-  			(*handleFeature)(fset.get(FREEZES_OPP_STR,data.pieceIndex[opp][copy.pieces[loc]]),handleFeatureData);
-  			(*handleFeature)(fset.get(FREEZES_OPP_AT,Board::SYMLOC[opp][loc]),handleFeatureData);
+  			features.add(fset.get(FREEZES_OPP_STR,data.pieceIndex[opp][copy.pieces[loc]]));
+  			features.add(fset.get(FREEZES_OPP_AT,Board::SYMLOC[opp][loc]));
   		}
   	}
   	Bitmap plaMap = (b.pieceMaps[pla][0] & b.frozenMap) ^ (copy.pieceMaps[pla][0] & copy.frozenMap);
@@ -897,13 +898,13 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   		loc_t loc = plaMap.nextBit();
   		if(b.owners[loc] == pla && b.isFrozen(loc))
   		{
-  			(*handleFeature)(fset.get(THAWS_PLA_STR,data.pieceIndex[pla][b.pieces[loc]]),handleFeatureData);
-  			(*handleFeature)(fset.get(THAWS_PLA_AT,Board::SYMLOC[pla][loc]),handleFeatureData);
+  			features.add(fset.get(THAWS_PLA_STR,data.pieceIndex[pla][b.pieces[loc]]));
+  			features.add(fset.get(THAWS_PLA_AT,Board::SYMLOC[pla][loc]));
   		}
   		else
   		{
-  			(*handleFeature)(fset.get(FREEZES_PLA_STR,data.pieceIndex[pla][copy.pieces[loc]]),handleFeatureData);
-  			(*handleFeature)(fset.get(FREEZES_PLA_AT,Board::SYMLOC[pla][loc]),handleFeatureData);
+  			features.add(fset.get(FREEZES_PLA_STR,data.pieceIndex[pla][copy.pieces[loc]]));
+  			features.add(fset.get(FREEZES_PLA_AT,Board::SYMLOC[pla][loc]));
   		}
   	}
   }
@@ -930,13 +931,13 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   			loc_t adj = oloc + Board::ADJOFFSETS[dir];
   			if(ArimaaFeature::isSinglePhalanx(b,pla,oloc,adj) && !ArimaaFeature::isSinglePhalanx(copy,pla,oloc,adj))
   			{
-  				(*handleFeature)(fset.get(RELEASES_PHALANX_VS,data.pieceIndex[opp][b.pieces[oloc]],1),handleFeatureData);
-  				(*handleFeature)(fset.get(RELEASES_PHALANX_AT,Board::SYMLOC[pla][oloc],Board::SYMDIR[opp][3-dir],1),handleFeatureData);
+  				features.add(fset.get(RELEASES_PHALANX_VS,data.pieceIndex[opp][b.pieces[oloc]],1));
+  				features.add(fset.get(RELEASES_PHALANX_AT,Board::SYMLOC[pla][oloc],Board::SYMDIR[opp][3-dir],1));
   			}
   			else if(ArimaaFeature::isMultiPhalanx(b,pla,oloc,adj) && !ArimaaFeature::isMultiPhalanx(copy,pla,oloc,adj))
   			{
-  				(*handleFeature)(fset.get(RELEASES_PHALANX_VS,data.pieceIndex[opp][b.pieces[oloc]],0),handleFeatureData);
-  				(*handleFeature)(fset.get(RELEASES_PHALANX_AT,Board::SYMLOC[pla][oloc],Board::SYMDIR[opp][3-dir],0),handleFeatureData);
+  				features.add(fset.get(RELEASES_PHALANX_VS,data.pieceIndex[opp][b.pieces[oloc]],0));
+  				features.add(fset.get(RELEASES_PHALANX_AT,Board::SYMLOC[pla][oloc],Board::SYMDIR[opp][3-dir],0));
   			}
   		}
   	}
@@ -952,13 +953,13 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   			loc_t adj = oloc + Board::ADJOFFSETS[dir];
   			if(!ArimaaFeature::isSinglePhalanx(b,pla,oloc,adj) && ArimaaFeature::isSinglePhalanx(copy,pla,oloc,adj))
   			{
-					(*handleFeature)(fset.get(CREATES_PHALANX_VS,data.pieceIndex[opp][copy.pieces[oloc]],1),handleFeatureData);
-					(*handleFeature)(fset.get(CREATES_PHALANX_AT,Board::SYMLOC[pla][oloc],Board::SYMDIR[opp][3-dir],1),handleFeatureData);
+					features.add(fset.get(CREATES_PHALANX_VS,data.pieceIndex[opp][copy.pieces[oloc]],1));
+					features.add(fset.get(CREATES_PHALANX_AT,Board::SYMLOC[pla][oloc],Board::SYMDIR[opp][3-dir],1));
 				}
   			else if(!ArimaaFeature::isMultiPhalanx(b,pla,oloc,adj) && ArimaaFeature::isMultiPhalanx(copy,pla,oloc,adj))
 				{
-  				(*handleFeature)(fset.get(CREATES_PHALANX_VS,data.pieceIndex[opp][copy.pieces[oloc]],0),handleFeatureData);
-					(*handleFeature)(fset.get(CREATES_PHALANX_AT,Board::SYMLOC[pla][oloc],Board::SYMDIR[opp][3-dir],0),handleFeatureData);
+  				features.add(fset.get(CREATES_PHALANX_VS,data.pieceIndex[opp][copy.pieces[oloc]],0));
+					features.add(fset.get(CREATES_PHALANX_AT,Board::SYMLOC[pla][oloc],Board::SYMDIR[opp][3-dir],0));
 				}
   		}
   	}
@@ -979,7 +980,7 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 					if(CW1(goalTarget)) {influence += data.influence[pla][goalTarget-1];}
 					if(CE1(goalTarget)) {influence += data.influence[pla][goalTarget+1];}
 					influence /= 4; //Averaging
-					(*handleFeature)(fset.get(RABBIT_ADVANCE,dist,influence),handleFeatureData);
+					features.add(fset.get(RABBIT_ADVANCE,dist,influence));
 				}
 
 				int advdest = Board::ADVANCEMENT[pla][dest[i]];
@@ -992,11 +993,11 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 				else influence = (data.influence[pla][Board::PLATRAPLOCS[OPP(pla)][0]] + data.influence[pla][Board::PLATRAPLOCS[OPP(pla)][1]])/2;
 
 				if(advdest > advsrc)
-					(*handleFeature)(fset.get(
-							PIECE_ADVANCE,data.pieceIndex[pla][b.pieces[src[i]]],influence),handleFeatureData);
+					features.add(fset.get(
+							PIECE_ADVANCE,data.pieceIndex[pla][b.pieces[src[i]]],influence));
 				else if(advdest < advsrc)
-					(*handleFeature)(fset.get(
-							PIECE_RETREAT,data.pieceIndex[pla][b.pieces[src[i]]],influence),handleFeatureData);
+					features.add(fset.get(
+							PIECE_RETREAT,data.pieceIndex[pla][b.pieces[src[i]]],influence));
 
 				loc_t nearestDomSrc = b.nearestDominator(pla,b.pieces[src[i]],src[i],4);
 				loc_t nearestDomDest = b.nearestDominator(pla,b.pieces[src[i]],dest[i],4);
@@ -1006,8 +1007,8 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 					if(nearestDomDest == ERRORSQUARE || rad < Board::MANHATTANDIST[dest[i]][nearestDomDest])
 					{
 						influence = data.influence[pla][src[i]];
-						(*handleFeature)(fset.get(
-								ESCAPE_DOMINATOR,data.pieceIndex[pla][b.pieces[src[i]]],influence,rad),handleFeatureData);
+						features.add(fset.get(
+								ESCAPE_DOMINATOR,data.pieceIndex[pla][b.pieces[src[i]]],influence,rad));
 					}
 				}
 				else if(nearestDomDest != ERRORSQUARE)
@@ -1016,8 +1017,8 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 					if(nearestDomSrc == ERRORSQUARE || rad < Board::MANHATTANDIST[src[i]][nearestDomSrc])
 					{
 						influence = data.influence[pla][dest[i]];
-						(*handleFeature)(fset.get(
-								APPROACH_DOMINATOR,data.pieceIndex[pla][b.pieces[src[i]]],influence,rad),handleFeatureData);
+						features.add(fset.get(
+								APPROACH_DOMINATOR,data.pieceIndex[pla][b.pieces[src[i]]],influence,rad));
 					}
 				}
 
@@ -1026,9 +1027,9 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 					int trapIndex = Board::TRAPINDEX[dest[i]];
 					int isOppTrap = !Board::ISPLATRAP[trapIndex][pla];
 					if(copy.trapGuardCounts[pla][trapIndex] >= 2)
-						(*handleFeature)(fset.get(SAFE_STEP_ON_TRAP,isOppTrap,data.pieceIndex[pla][b.pieces[src[i]]]),handleFeatureData);
+						features.add(fset.get(SAFE_STEP_ON_TRAP,isOppTrap,data.pieceIndex[pla][b.pieces[src[i]]]));
 					else
-						(*handleFeature)(fset.get(UNSAFE_STEP_ON_TRAP,isOppTrap,data.pieceIndex[pla][b.pieces[src[i]]]),handleFeatureData);
+						features.add(fset.get(UNSAFE_STEP_ON_TRAP,isOppTrap,data.pieceIndex[pla][b.pieces[src[i]]]));
 				}
 			}
 		}
@@ -1043,7 +1044,7 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 				if(!b.isDominated(priorLoc))
 				{
 					int influence = data.influence[pla][loc];
-					(*handleFeature)(fset.get(DOMINATES_ADJ,data.pieceIndex[opp][copy.pieces[loc]],influence),handleFeatureData);
+					features.add(fset.get(DOMINATES_ADJ,data.pieceIndex[opp][copy.pieces[loc]],influence));
 				}
 			}
 		}
@@ -1113,15 +1114,15 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
       	int pieceIndex = data.pieceIndex[opp][b.pieces[oppPPSrc]];
       	bool isWeaker = b.pieces[src[i]] < b.pieces[oppPPSrc];
       	int symDir = getSymDir(pla,oppPPDest,dest[i]);
-    		(*handleFeature)(fset.get(BLOCKS_PUSHPULLED,pieceIndex,isWeaker,symDir),handleFeatureData);
+    		features.add(fset.get(BLOCKS_PUSHPULLED,pieceIndex,isWeaker,symDir));
 
     		//While we're at it, if it's frozen...
     		if(copy.isFrozen(oppPPDest))
-    			(*handleFeature)(fset.get(BLOCKS_FROZEN,pieceIndex,isWeaker,symDir),handleFeatureData);
+    			features.add(fset.get(BLOCKS_FROZEN,pieceIndex,isWeaker,symDir));
 
     		//And if it's under capture threat...
     		if(capThreatMap.isOne(oppPPDest))
-      		(*handleFeature)(fset.get(BLOCKS_CAPTHREATED,pieceIndex,isWeaker,symDir),handleFeatureData);
+      		features.add(fset.get(BLOCKS_CAPTHREATED,pieceIndex,isWeaker,symDir));
       }
     }
 
@@ -1142,7 +1143,7 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 				int pieceIndex = data.pieceIndex[opp][copy.pieces[oloc]];
 				bool isWeaker = copy.pieces[ploc] < copy.pieces[oloc];
 				int symDir = getSymDir(pla,oloc,ploc);
-				(*handleFeature)(fset.get(BLOCKS_FROZEN,pieceIndex,isWeaker,symDir),handleFeatureData);
+				features.add(fset.get(BLOCKS_FROZEN,pieceIndex,isWeaker,symDir));
 			}
 		}
 
@@ -1166,7 +1167,7 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 				int pieceIndex = data.pieceIndex[opp][copy.pieces[oloc]];
 				bool isWeaker = copy.pieces[ploc] < copy.pieces[oloc];
 				int symDir = getSymDir(pla,oloc,ploc);
-				(*handleFeature)(fset.get(BLOCKS_CAPTHREATED,pieceIndex,isWeaker,symDir),handleFeatureData);
+				features.add(fset.get(BLOCKS_CAPTHREATED,pieceIndex,isWeaker,symDir));
 			}
 		}
   }
@@ -1176,9 +1177,9 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   	move_t reverseMove;
   	int rev = SearchUtils::isReversible(b,move,copy,reverseMove);
   	if(rev == 2)
-  		(*handleFeature)(fset.get(IS_FULL_REVERSIBLE),handleFeatureData);
+  		features.add(fset.get(IS_FULL_REVERSIBLE));
   	else if(rev == 1)
-  		(*handleFeature)(fset.get(IS_MOSTLY_REVERSIBLE),handleFeatureData);
+  		features.add(fset.get(IS_MOSTLY_REVERSIBLE));
   	else
   	{
   		int numOppMoved = 0;
@@ -1200,16 +1201,16 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   			if(Board::ISADJACENT[oppSrc][oppDest] && copy.owners[oppSrc] == NPLA &&
   					copy.isThawed(oppDest) && copy.isRabOkay(opp,oppDest,oppSrc))
   			{
-  				(*handleFeature)(fset.get(PUSHPULL_OPP_REVERSIBLE),handleFeatureData);
+  				features.add(fset.get(PUSHPULL_OPP_REVERSIBLE));
   			}
   		}
   	}
 
   	int fc = SearchUtils::isFreeCapturable(b,move,copy);
   	if(fc == 2)
-  		(*handleFeature)(fset.get(IS_FREE_CAPTURABLE),handleFeatureData);
+  		features.add(fset.get(IS_FREE_CAPTURABLE));
   	else if(fc == 1)
-  		(*handleFeature)(fset.get(IS_MOSTLY_FREE_CAPTURABLE),handleFeatureData);
+  		features.add(fset.get(IS_MOSTLY_FREE_CAPTURABLE));
   }
 
   if(ENABLE_LAST)
@@ -1222,7 +1223,7 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   			loc_t lastPushed = data.lastPushed[i];
   			if(b.owners[lastPushed] == pla && (copy.owners[lastPushed] != pla || copy.pieces[lastPushed] != b.pieces[lastPushed]))
   			{
-  				(*handleFeature)(fset.get(MOVES_LAST_PUSHED),handleFeatureData);
+  				features.add(fset.get(MOVES_LAST_PUSHED));
   				break;
   			}
   		}
@@ -1244,8 +1245,8 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
   	  if(lastLastNearness >= 64)
   	  	lastLastNearness = 63;
 
-  	  (*handleFeature)(fset.get(MOVES_NEAR_LAST,lastNearness),handleFeatureData);
-    	(*handleFeature)(fset.get(MOVES_NEAR_LAST_LAST,lastLastNearness),handleFeatureData);
+  	  features.add(fset.get(MOVES_NEAR_LAST,lastNearness));
+    	features.add(fset.get(MOVES_NEAR_LAST_LAST,lastLastNearness));
   	}
   }
 
@@ -1288,11 +1289,11 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 			//	contigScore += contig;
 			//}
 	  }
-	  (*handleFeature)(fset.get(NUM_INDEP_STEPS,numTotal,numIndep),handleFeatureData);
+	  features.add(fset.get(NUM_INDEP_STEPS,numTotal,numIndep));
 
 	  //if(contigScore > 24)
 	  //	contigScore = 24;
-	  //(*handleFeature)(fset.get(CONTIGUOUSITY,contigScore),handleFeatureData);
+	  //features.add(fset.get(CONTIGUOUSITY,contigScore));
   }
 
   /*
@@ -1311,12 +1312,12 @@ void MoveFeature::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla
 			loc_t k0 = Board::K0INDEX[step];
 			int feature0 = ptree->lookup(b,pla,k0,data.pStronger);
 			if(feature0 >= 0)
-				(*handleFeature)(fset.get(PATTERN,feature0),handleFeatureData);
+				features.add(fset.get(PATTERN,feature0));
 
 			loc_t k1 = Board::K1INDEX[step];
 			int feature1 = ptree->lookup(b,pla,k1,data.pStronger);
 			if(feature1 >= 0)
-				(*handleFeature)(fset.get(PATTERN,feature1),handleFeatureData);
+				features.add(fset.get(PATTERN,feature1));
 
 		  recs[i] = b.tempStepC(k0,k1);
   	}
@@ -22,6 +22,9 @@ namespace MoveFeature
 {
   extern bool IS_INITIALIZED;
 
+  //Bump whenever getPosData or getFeatures change which features a move gets, so that cached matches are rebuilt
+  const int EXTRACTOR_VERSION = 1;
+
   void initFeatureSet();
 
   const FeatureSet& getFeatureSet();
@@ -32,7 +35,7 @@ namespace MoveFeature
 
   void getFeatures(const Board& b, const FeaturePosData& data,
   		pla_t pla, move_t move, const BoardHistory& hist,
-  		void (*handleFeature)(findex_t,void*), void* handleFeatureData);
+  		FeatureBuffer& features);
 
 }
 
@@ -40,6 +43,9 @@ namespace MoveFeatureLite
 {
   extern bool IS_INITIALIZED;
 
+  //Bump whenever any of the getPosData functions or getFeatures change which features a move gets
+  const int EXTRACTOR_VERSION = 1;
+
   void initFeatureSet();
 
   const FeatureSet& getFeatureSet();
@@ -54,7 +60,7 @@ namespace MoveFeatureLite
 
   void getFeatures(const Board& b, const FeaturePosData& data,
   		pla_t pla, move_t move, const BoardHistory& hist,
-  		void (*handleFeature)(findex_t,void*), void* handleFeatureData);
+  		FeatureBuffer& features);
 
 }
 
@@ -115,17 +115,20 @@ const FeatureSet& MoveFeatureLite::getFeatureSet()
 
 ArimaaFeatureSet MoveFeatureLite::getArimaaFeatureSetSrcDestOnly()
 {
-	return ArimaaFeatureSet(&fset,MoveFeatureLite::getFeatures,MoveFeatureLite::getPosDataSrcDestOnly);
+	return ArimaaFeatureSet(&fset,MoveFeatureLite::getFeatures,MoveFeatureLite::getPosDataSrcDestOnly,
+			"MoveFeatureLite.SrcDestOnly",MoveFeatureLite::EXTRACTOR_VERSION);
 }
 
 ArimaaFeatureSet MoveFeatureLite::getArimaaFeatureSet()
 {
-	return ArimaaFeatureSet(&fset,MoveFeatureLite::getFeatures,MoveFeatureLite::getPosData);
+	return ArimaaFeatureSet(&fset,MoveFeatureLite::getFeatures,MoveFeatureLite::getPosData,
+			"MoveFeatureLite",MoveFeatureLite::EXTRACTOR_VERSION);
 }
 
 ArimaaFeatureSet MoveFeatureLite::getArimaaFeatureSetFullMove()
 {
-	return ArimaaFeatureSet(&fset,MoveFeatureLite::getFeatures,MoveFeatureLite::getPosDataFullMove);
+	return ArimaaFeatureSet(&fset,MoveFeatureLite::getFeatures,MoveFeatureLite::getPosDataFullMove,
+			"MoveFeatureLite.FullMove",MoveFeatureLite::EXTRACTOR_VERSION);
 }
 
 bool MoveFeatureLite::IS_INITIALIZED = false;
@@ -206,12 +209,12 @@ static void initPriors()
 
 
 void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf, pla_t pla, move_t move, const BoardHistory& hist,
-		void (*handleFeature)(findex_t,void*), void* handleFeatureData)
+		FeatureBuffer& features)
 {
   //Handle Pass Move
   if(move == PASSMOVE || move == QPASSMOVE)
   {
-    (*handleFeature)(fset.get(PASS),handleFeatureData);
+    features.add(fset.get(PASS));
     return;
   }
 
@@ -238,8 +241,8 @@ void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf,
       if(owner == pla) {srcFeature = SRC; destFeature = DEST;}
       else             {srcFeature = SRC_O; destFeature = DEST_O;}
 
-      (*handleFeature)(fset.get(srcFeature,pieceIndex,Board::SYMLOC[pla][src[i]]),handleFeatureData);
-      (*handleFeature)(fset.get(destFeature,pieceIndex,(dest[i] == ERRORSQUARE) ? 32 : Board::SYMLOC[pla][dest[i]]),handleFeatureData);
+      features.add(fset.get(srcFeature,pieceIndex,Board::SYMLOC[pla][src[i]]));
+      features.add(fset.get(destFeature,pieceIndex,(dest[i] == ERRORSQUARE) ? 32 : Board::SYMLOC[pla][dest[i]]));
     }
   }
 
@@ -260,13 +263,13 @@ void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf,
   		{
   			if(piece < data.oppMaxStrAdj[dest[i]])
   			{
-  				(*handleFeature)(fset.get(DOMINATED_STR,pieceIndex),handleFeatureData);
-  				(*handleFeature)(fset.get(DOMINATED_AT,Board::SYMLOC[pla][dest[i]]),handleFeatureData);
+  				features.add(fset.get(DOMINATED_STR,pieceIndex));
+  				features.add(fset.get(DOMINATED_AT,Board::SYMLOC[pla][dest[i]]));
   			}
   			if(piece > data.oppMinStrAdj[dest[i]])
   			{
-  				(*handleFeature)(fset.get(DOMINATES_STR,data.pieceIndex[opp][data.oppMinStrAdj[dest[i]]]),handleFeatureData);
-  				(*handleFeature)(fset.get(DOMINATES_AT,Board::SYMLOC[pla][dest[i]]),handleFeatureData);
+  				features.add(fset.get(DOMINATES_STR,data.pieceIndex[opp][data.oppMinStrAdj[dest[i]]]));
+  				features.add(fset.get(DOMINATES_AT,Board::SYMLOC[pla][dest[i]]));
   			}
   		}
 
@@ -274,8 +277,8 @@ void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf,
 			{
 				if(data.plaFrozen.isOne(src[i]))
 				{
-  				(*handleFeature)(fset.get(MOVES_FROZEN_STR,pieceIndex),handleFeatureData);
-  				(*handleFeature)(fset.get(MOVES_FROZEN_AT,Board::SYMLOC[pla][src[i]]),handleFeatureData);
+  				features.add(fset.get(MOVES_FROZEN_STR,pieceIndex));
+  				features.add(fset.get(MOVES_FROZEN_AT,Board::SYMLOC[pla][src[i]]));
 				}
 			}
 
@@ -284,14 +287,14 @@ void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf,
 				if(data.plaCapThreatenedPlaTrap.isOne(src[i]))
 				{
 					bool isPlaTrap = true;
-  				(*handleFeature)(fset.get(MOVES_CAPTHREATENED_STR,isPlaTrap,pieceIndex),handleFeatureData);
-  				(*handleFeature)(fset.get(MOVES_CAPTHREATENED_AT,isPlaTrap,Board::SYMLOC[pla][src[i]]),handleFeatureData);
+  				features.add(fset.get(MOVES_CAPTHREATENED_STR,isPlaTrap,pieceIndex));
+  				features.add(fset.get(MOVES_CAPTHREATENED_AT,isPlaTrap,Board::SYMLOC[pla][src[i]]));
 				}
 				if(data.plaCapThreatenedOppTrap.isOne(src[i]))
 				{
 					bool isPlaTrap = false;
-  				(*handleFeature)(fset.get(MOVES_CAPTHREATENED_STR,isPlaTrap,pieceIndex),handleFeatureData);
-  				(*handleFeature)(fset.get(MOVES_CAPTHREATENED_AT,isPlaTrap,Board::SYMLOC[pla][src[i]]),handleFeatureData);
+  				features.add(fset.get(MOVES_CAPTHREATENED_STR,isPlaTrap,pieceIndex));
+  				features.add(fset.get(MOVES_CAPTHREATENED_AT,isPlaTrap,Board::SYMLOC[pla][src[i]]));
 				}
 				loc_t adjTrap = Board::ADJACENTTRAP[dest[i]];
 				if(adjTrap != ERRORSQUARE)
@@ -301,8 +304,8 @@ void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf,
 					{
 						bool isPlaTrap = Board::ISPLATRAP[trapIndex][pla];
 						int defCount = newTrapGuardCounts[pla][trapIndex];
-	  				(*handleFeature)(fset.get(DEFENDS_CAPTHREATED_TRAP_STR,isPlaTrap,defCount,data.oppTrapState[trapIndex],pieceIndex),handleFeatureData);
-	  				(*handleFeature)(fset.get(DEFENDS_CAPTHREATED_TRAP_AT,isPlaTrap,Board::SYMLOC[pla][dest[i]]),handleFeatureData);
+	  				features.add(fset.get(DEFENDS_CAPTHREATED_TRAP_STR,isPlaTrap,defCount,data.oppTrapState[trapIndex],pieceIndex));
+	  				features.add(fset.get(DEFENDS_CAPTHREATED_TRAP_AT,isPlaTrap,Board::SYMLOC[pla][dest[i]]));
 					}
 				}
 			}
@@ -314,27 +317,27 @@ void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf,
 	    	{
 	    		int trapIndex = Board::TRAPINDEX[adjTrap];
 	    		if(newTrapGuardCounts[pla][trapIndex] == 1 && piece <= data.likelyDangerAdjTrapStr[dest[i]])
-	  				(*handleFeature)(fset.get(LIKELY_CAPDANGER_ADJ,Board::ISPLATRAP[trapIndex][pla]),handleFeatureData);
+	  				features.add(fset.get(LIKELY_CAPDANGER_ADJ,Board::ISPLATRAP[trapIndex][pla]));
 	    	}
 	    	loc_t adjTrap2 = Board::RAD2TRAP[dest[i]];
 	    	if(adjTrap2 != ERRORSQUARE)
 	    	{
 	    		int trapIndex2 = Board::TRAPINDEX[adjTrap2];
 	    		if(newTrapGuardCounts[pla][trapIndex2] == 0 && piece <= data.likelyDangerAdj2TrapStr[dest[i]])
-	  				(*handleFeature)(fset.get(LIKELY_CAPDANGER_ADJ2,Board::ISPLATRAP[trapIndex2][pla]),handleFeatureData);
+	  				features.add(fset.get(LIKELY_CAPDANGER_ADJ2,Board::ISPLATRAP[trapIndex2][pla]));
 	    	}
 
 	    	if(piece >= data.likelyThreatStr[dest[i]])
-  				(*handleFeature)(fset.get(LIKELY_CAPTHREAT_STATIC),handleFeatureData);
+  				features.add(fset.get(LIKELY_CAPTHREAT_STATIC));
 	    	else if(piece >= data.likelyLooseThreatStr[dest[i]])
-  				(*handleFeature)(fset.get(LIKELY_CAPTHREAT_LOOSE),handleFeatureData);
+  				features.add(fset.get(LIKELY_CAPTHREAT_LOOSE));
 	    }
 
 	    /*
 	    if(ENABLE_RABGDIST && piece == RAB)
 	    {
-	    	(*handleFeature)(fset.get(RAB_GOAL_DIST_SRC,data.rabbitGoalDist[src[i]]),handleFeatureData);
-	    	(*handleFeature)(fset.get(RAB_GOAL_DIST_DEST,data.rabbitGoalDist[dest[i]]),handleFeatureData);
+	    	features.add(fset.get(RAB_GOAL_DIST_SRC,data.rabbitGoalDist[src[i]]));
+	    	features.add(fset.get(RAB_GOAL_DIST_DEST,data.rabbitGoalDist[dest[i]]));
 	    }
 	    */
     }
@@ -344,9 +347,9 @@ void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf,
 	    if(ENABLE_LIKELY_CAPTHREAT)
 	    {
 	    	if(data.likelyThreatPushPullLocs.isOne(dest[i]))
-  				(*handleFeature)(fset.get(LIKELY_CAPTHREAT_PUSHPULL),handleFeatureData);
+  				features.add(fset.get(LIKELY_CAPTHREAT_PUSHPULL));
 	    	else if(data.likelyThreatPushPullLocsLoose.isOne(dest[i]))
-  				(*handleFeature)(fset.get(LIKELY_CAPTHREAT_PUSHPULL_LOOSE),handleFeatureData);
+  				features.add(fset.get(LIKELY_CAPTHREAT_PUSHPULL_LOOSE));
 	    }
     }
   }
@@ -356,7 +359,7 @@ void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf,
   	for(int trapIndex = 0; trapIndex < 4; trapIndex++)
   	{
     	if(data.trapNeedsMoreDefs[trapIndex] && newTrapGuardCounts[pla][trapIndex] > b.trapGuardCounts[pla][trapIndex])
-				(*handleFeature)(fset.get(LIKELY_CAPTRAPDEF,Board::ISPLATRAP[trapIndex][pla]),handleFeatureData);
+				features.add(fset.get(LIKELY_CAPTRAPDEF,Board::ISPLATRAP[trapIndex][pla]));
     	else if(!data.trapNeedsMoreDefs[trapIndex] && newTrapGuardCounts[pla][trapIndex] < b.trapGuardCounts[pla][trapIndex] &&
 							newTrapGuardCounts[pla][trapIndex] < data.minDefendersToBeLikelySafe[trapIndex])
     	{
@@ -383,7 +386,7 @@ void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf,
     		}
 
     		if(foundHanging)
-  				(*handleFeature)(fset.get(LIKELY_CAPHANG,Board::ISPLATRAP[trapIndex][pla]),handleFeatureData);
+  				features.add(fset.get(LIKELY_CAPHANG,Board::ISPLATRAP[trapIndex][pla]));
     	}
   	}
   }
@@ -416,7 +419,7 @@ void MoveFeatureLite::getFeatures(const Board& b, const FeaturePosData& dataBuf,
 			dependDest |= Board::RADIUS[1][dest];
 
 		}
-		(*handleFeature)(fset.get(NUM_INDEP_STEPS,numTotal,numIndep),handleFeatureData);
+		features.add(fset.get(NUM_INDEP_STEPS,numTotal,numIndep));
 	}
 
 }
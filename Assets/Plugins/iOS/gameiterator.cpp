@@ -10,6 +10,9 @@
 #include <sstream>
 #include <algorithm>
 #include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
 #include "global.h"
 #include "rand.h"
 #include "board.h"
@@ -30,43 +33,69 @@ double GameIterator::MOVE_KEEP_PROP = 1.0;
 int GameIterator::MOVE_KEEP_THRESHOLD = 1;
 bool GameIterator::DO_PRINT = false;
 
-static int getNextMoves(Board& b, move_t recordedMove, int move_type, move_t& nextMove, move_t* nextMoves);
+static int getNextMoves(Board& b, move_t recordedMove, int move_type, move_t& nextMove, move_t* nextMoves, Rand& rand,
+		hash_t* fullHashKeys, uint8_t* fullHashExists);
 static move_t rearrangeMoveToJoinCombos(Board& b, move_t move);
-static int genFullMoves(Board& b, move_t* moves, int maxSteps);
-static int genFullMoveHelper(Board& b, move_t* moves, move_t moveSoFar, int stepIndex, int maxSteps);
-
-static int moveBufSize = -1;
-static move_t* moveBuf = NULL;
+static void joinCombos(GameRecord& game);
+static int genFullMoves(Board& b, move_t* moves, int maxSteps, hash_t* hashKeys, uint8_t* hashExists);
+static int genFullMoveHelper(Board& b, move_t* moves, move_t moveSoFar, int stepIndex, int maxSteps,
+		hash_t* hashKeys, uint8_t* hashExists);
+static const hash_t MV_FULL_HASH_SIZE = 1ULL<<21;
+static const hash_t MV_FULL_HASH_MASK = (1ULL<<21)-1ULL;
 
-static void ensureMoveBuf(int moveType)
+static int getMoveBufSize(int moveType)
 {
-	int size = 0;
 	if(moveType == GameIterator::FULL_MOVES)
-		size = 4000000;
+		return 4000000;
 	else if(moveType == GameIterator::LOCAL_COMBO_MOVES)
-		size = 400000;
+		return 400000;
 	else if(moveType == GameIterator::SIMPLE_CHAIN_MOVES)
-		size = 4096;
+		return 4096;
 	else if(moveType == GameIterator::STEP_MOVES)
-		size = 256;
+		return 256;
+	Global::fatalError("GameIterator: Unknown move type!");
+	return 0;
+}
 
-	if(moveBufSize >= 0 && moveBufSize < size)
-	{
-		moveBufSize = -1;
-		delete[] moveBuf;
-		moveBuf = NULL;
-	}
+//FEATURE MATCHES--------------------------------------------------------------------
 
-	if(moveBuf == NULL)
-	{
-		moveBufSize = size;
-		moveBuf = new move_t[size];
-	}
+FeatureMatches::FeatureMatches()
+{
+	clear();
+}
+
+void FeatureMatches::clear()
+{
+	winners.clear();
+	matchTeamStart.clear();
+	teamFeatureStart.clear();
+	features.clear();
+	matchTeamStart.push_back(0);
+	teamFeatureStart.push_back(0);
+}
+
+void FeatureMatches::beginMatch(int winner)
+{
+	winners.push_back(winner);
+	matchTeamStart.push_back(matchTeamStart.back());
+}
+
+void FeatureMatches::addTeam(const findex_t* teamFeatures, int numFeatures)
+{
+	DEBUGASSERT(winners.size() > 0);
+	features.insert(features.end(),teamFeatures,teamFeatures+numFeatures);
+	teamFeatureStart.push_back(features.size());
+	matchTeamStart.back()++;
 }
 
+//GAME ITERATOR----------------------------------------------------------------------
+
 GameIterator::GameIterator(const char* filename, int mType, bool filter)
+:rand(Rand::rand.nextUInt64())
 {
-	games = ArimaaIO::readMovesFile(filename);
+	games = shared_ptr<ArimaaIO::MovesFileReader>(new ArimaaIO::MovesFileReader(filename));
+	gameStart = 0;
+	gameEnd = games->numRecords();
 	currentGameIdx = -1;
 	currentGameNumMoves = 0;
 	currentTurn = 0;
@@ -74,22 +103,28 @@ GameIterator::GameIterator(const char* filename, int mType, bool filter)
 	doFiltering = filter;
 
 	moveType = mType;
+	moveBuf.resize(getMoveBufSize(moveType));
+	hasGameSeed = false;
+	gameSeed = 0;
 
   move = ERRORMOVE;
+}
 
-  //Convert all the moves to join the comboed steps together.
-  for(int i = 0; i<(int)games.size(); i++)
-  {
-    Board b = games[i].board;
-    for(int j = 0; j<(int)games[i].moves.size(); j++)
-    {
-      move_t m = rearrangeMoveToJoinCombos(b, games[i].moves[j]);
-      games[i].moves[j] = m;
-      bool suc = b.makeMoveLegal(m);
-      if(!suc)
-        cout << "MatchIterator: comboJoining error" << endl;
-    }
-  }
+GameIterator::GameIterator(const GameIterator& source, uint64_t seed)
+:games(source.games),gameStart(source.gameStart),gameEnd(source.gameEnd),rand(seed)
+{
+	currentGameIdx = gameStart-1;
+	currentGameNumMoves = 0;
+	currentTurn = 0;
+	nextStep = 0;
+	doFiltering = source.doFiltering;
+
+	moveType = source.moveType;
+	moveBuf.resize(getMoveBufSize(moveType));
+	hasGameSeed = true;
+	gameSeed = seed;
+
+  move = ERRORMOVE;
 }
 
 GameIterator::~GameIterator()
@@ -97,6 +132,25 @@ GameIterator::~GameIterator()
 
 }
 
+int GameIterator::numGames() const
+{
+	return games->numRecords();
+}
+
+void GameIterator::setGameRange(int start, int end)
+{
+	DEBUGASSERT(start >= 0 && start <= end && end <= games->numRecords());
+	gameStart = start;
+	gameEnd = end;
+	currentGameIdx = gameStart-1;
+	currentGameNumMoves = 0;
+	currentTurn = 0;
+	nextStep = 0;
+	board = Board();
+	hist = BoardHistory();
+	move = ERRORMOVE;
+}
+
 vector<bool> GameIterator::getFiltering(const GameRecord& game, const BoardHistory& hist)
 {
 	vector<bool> filter;
@@ -229,7 +283,7 @@ bool GameIterator::next()
 		bool suc = nextHelper();
 		if(suc)
 		{
-			if(Rand::rand.nextDouble() < GAME_KEEP_PROP)
+			if(rand.nextDouble() < GAME_KEEP_PROP)
 				return true;
 			else
 				continue;
@@ -240,7 +294,7 @@ bool GameIterator::next()
 
 bool GameIterator::nextHelper()
 {
-	if(currentGameIdx >= (int)games.size())
+	if(currentGameIdx >= gameEnd)
 		return false;
 
 	if(nextStep != 0)
@@ -257,8 +311,7 @@ bool GameIterator::nextHelper()
 		board = copy;
 
 	  move_t nextMove;
-		ensureMoveBuf(moveType);
-		getNextMoves(copy,hist.turnMove[currentTurn],moveType,nextMove,moveBuf);
+		genNextMoves(copy,hist.turnMove[currentTurn],nextMove);
 
 		move = nextMove;
 
@@ -280,7 +333,7 @@ bool GameIterator::nextHelper()
 			if(DO_PRINT)
 				cout << "Iterating game " << currentGameIdx << endl;
 
-			if(currentGameIdx >= (int)games.size())
+			if(currentGameIdx >= gameEnd)
 			{
 				board = Board();
 				hist = BoardHistory();
@@ -288,11 +341,15 @@ bool GameIterator::nextHelper()
 				return false;
 			}
 
-			currentGameNumMoves = games[currentGameIdx].moves.size();
+			currentGame = games->get(currentGameIdx);
+			joinCombos(currentGame);
+			currentGameNumMoves = currentGame.moves.size();
 			currentTurn = 0;
-			hist = BoardHistory(games[currentGameIdx]);
+			hist = BoardHistory(currentGame);
 			if(doFiltering)
-				turnFiltered = getFiltering(games[currentGameIdx],hist);
+				turnFiltered = getFiltering(currentGame,hist);
+			if(hasGameSeed)
+				rand.init(gameSeed + (uint64_t)currentGameIdx);
 			continue;
 		}
 
@@ -319,8 +376,7 @@ bool GameIterator::nextHelper()
 			board = copy;
 
 		  move_t nextMove;
-			ensureMoveBuf(moveType);
-			getNextMoves(copy,hist.turnMove[currentTurn],moveType,nextMove,moveBuf);
+			genNextMoves(copy,hist.turnMove[currentTurn],nextMove);
 
 			move = nextMove;
 
@@ -339,8 +395,7 @@ void GameIterator::computeNextMoves(int& winningMoveIdx, vector<move_t>& moves)
 	Board copy = board;
 
   move_t nextMove;
-	ensureMoveBuf(moveType);
-	int nextMovesLen = getNextMoves(copy,move,moveType,nextMove,moveBuf);
+	int nextMovesLen = genNextMoves(copy,move,nextMove);
 
 	moves.clear();
 	moves.reserve(nextMovesLen);
@@ -370,15 +425,19 @@ void GameIterator::computeMoveFeatures(ArimaaFeatureSet afset, int& winningTeam,
 	Board copy = board;
 
   move_t nextMove;
-	ensureMoveBuf(moveType);
-	int nextMovesLen = getNextMoves(copy,move,moveType,nextMove,moveBuf);
+	int nextMovesLen = genNextMoves(copy,move,nextMove);
 
   //Build all the feature teams!
   FeaturePosData data;
   afset.getPosData(copy,hist,pla,data);
-  teams.clear();
+  //Resize rather than clear so that the inner vectors keep their capacity across calls
+  FeatureBuffer buf;
+  teams.resize(nextMovesLen);
   for(int i = 0; i<nextMovesLen; i++)
-    teams.push_back(afset.getFeatures(copy,data,pla,moveBuf[i],hist));
+  {
+    afset.getFeatures(copy,data,pla,moveBuf[i],hist,buf);
+    teams[i].assign(buf.features,buf.features+buf.numFeatures);
+  }
 
   //Locate the winner
   winningTeam = -1;
@@ -394,7 +453,224 @@ void GameIterator::computeMoveFeatures(ArimaaFeatureSet afset, int& winningTeam,
   	Global::fatalError(string("computeMoveFeatures: winning team not found!") + writeBoard(board) + writeMove(move));
 }
 
-static int getNextMoves(Board& b, move_t recordedMove, int move_type, move_t& nextMove, move_t* nextMoves)
+void GameIterator::computeMoveFeatures(ArimaaFeatureSet afset, FeatureMatches& matches, FeatureBuffer& buf)
+{
+  //Compute the data for this spot
+	pla_t pla = board.player;
+	Board copy = board;
+
+  move_t nextMove;
+	int nextMovesLen = genNextMoves(copy,move,nextMove);
+
+  //Locate the winner
+	int winningTeam = -1;
+  for(int i = 0; i<nextMovesLen; i++)
+  {
+    if(moveBuf[i] == nextMove)
+    {
+      winningTeam = i;
+      break;
+    }
+  }
+  if(winningTeam == -1)
+  	Global::fatalError(string("computeMoveFeatures: winning team not found!") + writeBoard(board) + writeMove(move));
+
+  //Build all the feature teams directly into the match arrays
+  FeaturePosData data;
+  afset.getPosData(copy,hist,pla,data);
+  matches.beginMatch(winningTeam);
+  for(int i = 0; i<nextMovesLen; i++)
+  {
+    afset.getFeatures(copy,data,pla,moveBuf[i],hist,buf);
+    matches.addTeam(buf.features,buf.numFeatures);
+  }
+}
+
+//PARALLEL FEATURE EXTRACTION-------------------------------------------------------
+
+//Single producer single consumer lock-free ring of pointers to blocks of matches
+struct FeatureMatchRing
+{
+	static const int MAX_CAPACITY = 8;
+	//A blocked push or pop yields this many times before sleeping between tries. A game takes milliseconds to
+	//compute or consume, so a waiting side would otherwise burn a whole core spinning.
+	static const int NUM_SPINS = 16;
+	static const int SLEEP_MICROS = 100;
+
+	FeatureMatches* slots[MAX_CAPACITY];
+	uint64_t capacity;
+	std::atomic<uint64_t> head; //Next slot to pop, written only by the consumer
+	std::atomic<uint64_t> tail; //Next slot to push, written only by the producer
+
+	FeatureMatchRing(int cap)
+	:capacity(cap),head(0),tail(0)
+	{
+		DEBUGASSERT(cap > 0 && cap <= MAX_CAPACITY);
+	}
+
+	bool tryPush(FeatureMatches* block)
+	{
+		uint64_t t = tail.load(std::memory_order_relaxed);
+		if(t - head.load(std::memory_order_acquire) >= capacity)
+			return false;
+		slots[t % capacity] = block;
+		tail.store(t+1,std::memory_order_release);
+		return true;
+	}
+
+	FeatureMatches* tryPop()
+	{
+		uint64_t h = head.load(std::memory_order_relaxed);
+		if(h == tail.load(std::memory_order_acquire))
+			return NULL;
+		FeatureMatches* block = slots[h % capacity];
+		head.store(h+1,std::memory_order_release);
+		return block;
+	}
+
+	static void backoff(int numTries)
+	{
+		if(numTries < NUM_SPINS)
+			std::this_thread::yield();
+		else
+			std::this_thread::sleep_for(std::chrono::microseconds(SLEEP_MICROS));
+	}
+
+	void push(FeatureMatches* block)
+	{
+		for(int numTries = 0; !tryPush(block); numTries++)
+			backoff(numTries);
+	}
+
+	FeatureMatches* pop()
+	{
+		FeatureMatches* block;
+		for(int numTries = 0; (block = tryPop()) == NULL; numTries++)
+			backoff(numTries);
+		return block;
+	}
+};
+
+//Per-thread state for computeAllMoveFeatures. Filled blocks go to the consumer through filled, and come back
+//through recycled to be reused. The worker only allocates a block when recycled is empty, at which point every
+//block is either in filled or held by the consumer, so there are never more than FILLED_CAPACITY+2 blocks and
+//recycled always has room for all of them.
+struct FeatureMatchWorker
+{
+	static const int FILLED_CAPACITY = 4;
+
+	FeatureMatchRing filled;
+	FeatureMatchRing recycled;
+	vector<FeatureMatches*> owned;
+
+	FeatureMatchWorker()
+	:filled(FILLED_CAPACITY),recycled(FILLED_CAPACITY+2),owned()
+	{}
+};
+
+//Compute the features of games start, start+stride, ... within [start,end), pushing one block per game
+static void computeFeatureMatchesWorker(GameIterator& iter, ArimaaFeatureSet afset, FeatureMatchWorker& worker,
+		int start, int end, int stride)
+{
+	FeatureBuffer buf;
+	for(int g = start; g < end; g += stride)
+	{
+		FeatureMatches* block = worker.recycled.tryPop();
+		if(block == NULL)
+		{
+			block = new FeatureMatches();
+			worker.owned.push_back(block);
+			DEBUGASSERT((int)worker.owned.size() <= FeatureMatchWorker::FILLED_CAPACITY+2);
+		}
+		block->clear();
+
+		iter.setGameRange(g,g+1);
+		while(iter.next())
+			iter.computeMoveFeatures(afset,*block,buf);
+		worker.filled.push(block);
+	}
+}
+
+void GameIterator::computeAllMoveFeatures(ArimaaFeatureSet afset, int numThreads,
+		const function<void(const FeatureMatches&)>& consume)
+{
+	if(numThreads <= 0)
+		Global::fatalError("GameIterator::computeAllMoveFeatures: numThreads must be positive");
+
+	//Each shard iterator owns its own buffers and random state, reseeded per game so that thread count doesn't matter
+	uint64_t seed = rand.nextUInt64();
+	int start = gameStart;
+	int end = gameEnd;
+	if(numThreads > end-start)
+		numThreads = max(end-start,1);
+
+	vector<GameIterator*> shards;
+	vector<FeatureMatchWorker*> workers;
+	for(int t = 0; t<numThreads; t++)
+	{
+		shards.push_back(new GameIterator(*this,seed));
+		workers.push_back(new FeatureMatchWorker());
+	}
+
+	//Single threaded, just alternate computing a game and consuming it
+	if(numThreads == 1)
+	{
+		FeatureBuffer buf;
+		FeatureMatches block;
+		for(int g = start; g < end; g++)
+		{
+			block.clear();
+			shards[0]->setGameRange(g,g+1);
+			while(shards[0]->next())
+				shards[0]->computeMoveFeatures(afset,block,buf);
+			consume(block);
+		}
+	}
+	//Game g is computed by thread (g-start) % numThreads, and consumed here in order of games
+	else
+	{
+		vector<std::thread> threads;
+		for(int t = 0; t<numThreads; t++)
+			threads.push_back(std::thread(computeFeatureMatchesWorker,std::ref(*shards[t]),afset,std::ref(*workers[t]),
+					start+t,end,numThreads));
+
+		for(int g = start; g < end; g++)
+		{
+			FeatureMatchWorker& worker = *workers[(g-start) % numThreads];
+			FeatureMatches* block = worker.filled.pop();
+			consume(*block);
+			worker.recycled.push(block);
+		}
+
+		for(int t = 0; t<numThreads; t++)
+			threads[t].join();
+	}
+
+	for(int t = 0; t<numThreads; t++)
+	{
+		for(int i = 0; i<(int)workers[t]->owned.size(); i++)
+			delete workers[t]->owned[i];
+		delete workers[t];
+		delete shards[t];
+	}
+
+	//Leave this iterator exhausted, as if next() had been called through all the games
+	setGameRange(start,end);
+	currentGameIdx = end;
+}
+
+int GameIterator::genNextMoves(Board& b, move_t recordedMove, move_t& nextMove)
+{
+	if(moveType == FULL_MOVES && fullMoveHashKeys.size() == 0)
+	{
+		fullMoveHashKeys.resize(MV_FULL_HASH_SIZE);
+		fullMoveHashExists.resize(MV_FULL_HASH_SIZE);
+	}
+	return getNextMoves(b,recordedMove,moveType,nextMove,moveBuf.data(),rand,fullMoveHashKeys.data(),fullMoveHashExists.data());
+}
+
+static int getNextMoves(Board& b, move_t recordedMove, int move_type, move_t& nextMove, move_t* nextMoves, Rand& rand,
+		hash_t* fullHashKeys, uint8_t* fullHashExists)
 {
   int maxSteps = 4-b.step;
 
@@ -422,7 +698,7 @@ static int getNextMoves(Board& b, move_t recordedMove, int move_type, move_t& ne
   }
   else if(move_type == GameIterator::FULL_MOVES)
   {
-  	num += genFullMoves(b,nextMoves+num,maxSteps);
+  	num += genFullMoves(b,nextMoves+num,maxSteps,fullHashKeys,fullHashExists);
   	if(num > 2000000)
   		cout << "ArimaaFeature::genMoves .. fullMoves .. Num = " << num << endl;
 
@@ -497,7 +773,7 @@ static int getNextMoves(Board& b, move_t recordedMove, int move_type, move_t& ne
     {
       if(nextMoves[i] == nextMove)
         nextMoves[newNum++] = nextMoves[i];
-      else if(Rand::rand.nextDouble() < (double)numToKeep/(num-i))
+      else if(rand.nextDouble() < (double)numToKeep/(num-i))
       {
         nextMoves[newNum++] = nextMoves[i];
         numToKeep--;
@@ -579,6 +855,20 @@ static int getNextMoves(Board& b, move_t recordedMove, int move_type, move_t& ne
   return num;
 }
 
+//Convert all the moves to join the comboed steps together.
+static void joinCombos(GameRecord& game)
+{
+  Board b = game.board;
+  for(int j = 0; j<(int)game.moves.size(); j++)
+  {
+    move_t m = rearrangeMoveToJoinCombos(b, game.moves[j]);
+    game.moves[j] = m;
+    bool suc = b.makeMoveLegal(m);
+    if(!suc)
+      cout << "MatchIterator: comboJoining error" << endl;
+  }
+}
+
 static move_t rearrangeMoveToJoinCombos(Board& b, move_t move)
 {
   int dependencyStrength[4][4];
@@ -664,27 +954,23 @@ static move_t rearrangeMoveToJoinCombos(Board& b, move_t move)
   return bestMove;
 }
 
-static const hash_t MV_FULL_HASH_SIZE = 1ULL<<21;
-static const hash_t MV_FULL_HASH_MASK = (1ULL<<21)-1ULL;
-static hash_t* mvFullHashKeys;
-static bool* mvFullHashExists;
-
-static int genFullMoveHelper(Board& b, move_t* moves, move_t moveSoFar, int stepIndex, int maxSteps)
+static int genFullMoveHelper(Board& b, move_t* moves, move_t moveSoFar, int stepIndex, int maxSteps,
+		hash_t* hashKeys, uint8_t* hashExists)
 {
 	hash_t hash = b.sitCurrentHash;
 	int hashIndex = (int)(hash & MV_FULL_HASH_MASK);
 	int hashIndex2 = (int)((hash >> 21) & MV_FULL_HASH_MASK);
 	int hashIndex3 = (int)((hash >> 42) & MV_FULL_HASH_MASK);
-	if((mvFullHashExists[hashIndex] && mvFullHashKeys[hashIndex] == hash) ||
-		 (mvFullHashExists[hashIndex2] && mvFullHashKeys[hashIndex2] == hash) ||
-		 (mvFullHashExists[hashIndex3] && mvFullHashKeys[hashIndex3] == hash))
+	if((hashExists[hashIndex] && hashKeys[hashIndex] == hash) ||
+		 (hashExists[hashIndex2] && hashKeys[hashIndex2] == hash) ||
+		 (hashExists[hashIndex3] && hashKeys[hashIndex3] == hash))
 		return 0;
-	mvFullHashExists[hashIndex] = true;
-	mvFullHashKeys[hashIndex] = hash;
-	mvFullHashExists[hashIndex2] = true;
-	mvFullHashKeys[hashIndex2] = hash;
-	mvFullHashExists[hashIndex3] = true;
-	mvFullHashKeys[hashIndex3] = hash;
+	hashExists[hashIndex] = true;
+	hashKeys[hashIndex] = hash;
+	hashExists[hashIndex2] = true;
+	hashKeys[hashIndex2] = hash;
+	hashExists[hashIndex3] = true;
+	hashKeys[hashIndex3] = hash;
 
 	if(moveSoFar != ERRORMOVE && (b.posCurrentHash == b.posStartHash))
 		return 0;
@@ -710,20 +996,16 @@ static int genFullMoveHelper(Board& b, move_t* moves, move_t moveSoFar, int step
 		Board copy = b;
 		copy.makeMove(mv[i]);
 		int ns = Board::numStepsInMove(mv[i]);
-		numTotalMoves += genFullMoveHelper(copy,moves+numTotalMoves,Board::concatMoves(moveSoFar,mv[i],stepIndex),stepIndex+ns,maxSteps-ns);
+		numTotalMoves += genFullMoveHelper(copy,moves+numTotalMoves,Board::concatMoves(moveSoFar,mv[i],stepIndex),stepIndex+ns,maxSteps-ns,
+				hashKeys,hashExists);
 	}
 	return numTotalMoves;
 }
 
-static int genFullMoves(Board& b, move_t* moves, int maxSteps)
+static int genFullMoves(Board& b, move_t* moves, int maxSteps, hash_t* hashKeys, uint8_t* hashExists)
 {
-	if(mvFullHashKeys == NULL)
-		mvFullHashKeys = new hash_t[MV_FULL_HASH_SIZE];
-	if(mvFullHashExists == NULL)
-		mvFullHashExists = new bool[MV_FULL_HASH_SIZE];
-
 	for(int i = 0; i<(int)MV_FULL_HASH_SIZE; i++)
-		mvFullHashExists[i] = false;
+		hashExists[i] = false;
 
-	return genFullMoveHelper(b, moves, ERRORMOVE, 0, maxSteps);
+	return genFullMoveHelper(b, moves, ERRORMOVE, 0, maxSteps, hashKeys, hashExists);
 }
@@ -7,20 +7,48 @@
 #define GAMEITERATOR_H_
 
 #include <vector>
+#include <memory>
+#include <functional>
+#include "rand.h"
 #include "board.h"
 #include "boardhistory.h"
 #include "gamerecord.h"
+#include "arimaaio.h"
 #include "feature.h"
 #include "featuremove.h"
 
 using namespace std;
 
+//The feature teams of many positions packed into flat arrays, rather than a vector of vectors per position
+struct FeatureMatches
+{
+  vector<int> winners;          //Index of the winning team within each match
+  vector<int> matchTeamStart;   //Index of the first team of each match, with one more entry at the end
+  vector<int> teamFeatureStart; //Index of the first feature of each team, with one more entry at the end
+  vector<findex_t> features;
+
+  FeatureMatches();
+
+  inline int numMatches() const
+  {return winners.size();}
+  inline int numTeams(int m) const
+  {return matchTeamStart[m+1] - matchTeamStart[m];}
+
+  void clear();
+  //Start a new match. Its teams are then added in order by addTeam
+  void beginMatch(int winner);
+  void addTeam(const findex_t* teamFeatures, int numFeatures);
+};
+
 class GameIterator
 {
   private:
 
-  vector<GameRecord> games;
+  shared_ptr<ArimaaIO::MovesFileReader> games; //Shared between an iterator and its shards
+  int gameStart; //Range of games to iterate over
+  int gameEnd;
   int currentGameIdx;
+  GameRecord currentGame; //Read from games when reached, with comboed steps joined together
   int currentGameNumMoves;
   int currentTurn;
   int nextStep;
@@ -30,6 +58,13 @@ class GameIterator
   vector<bool> turnFiltered;
   bool doFiltering;
 
+  vector<move_t> moveBuf;            //Scratch space for generating moves, sized for moveType
+  vector<hash_t> fullMoveHashKeys;   //Positions already reached while generating FULL_MOVES
+  vector<uint8_t> fullMoveHashExists;
+  Rand rand;              //For GAME_KEEP_PROP and MOVE_KEEP_PROP
+  bool hasGameSeed;       //If true, reseed rand with gameSeed + the game index at the start of each game
+  uint64_t gameSeed;
+
   public:
 
   static const int STEP_MOVES = 0;
@@ -47,13 +82,30 @@ class GameIterator
   BoardHistory hist;
   move_t move;
 
+  //The random state is seeded from Rand::rand, so runs after Init::init(seed) are reproducible
   GameIterator(const char* filename, int moveType, bool doFiltering);
+  //Construct an iterator sharing the games and settings of source, starting over from the first game, with its own
+  //buffers and random state so that it can run on a different thread than source. The random state is reseeded from
+  //seed at the start of every game, so the positions and moves kept depend only on seed and the game.
+  GameIterator(const GameIterator& source, uint64_t seed);
   ~GameIterator();
 
+  int numGames() const;
+  //Restrict iteration to games [start,end) and start over from the beginning of that range
+  void setGameRange(int start, int end);
+
   bool next();
 
   void computeNextMoves(int& winningMoveIdx, vector<move_t>& moves);
   void computeMoveFeatures(ArimaaFeatureSet afset, int& winningTeam, vector<vector<findex_t> >& teams);
+  //Append the features of the current position as a new match of matches
+  void computeMoveFeatures(ArimaaFeatureSet afset, FeatureMatches& matches, FeatureBuffer& buf);
+
+  //Compute the features of every position that next() would iterate over, starting over from the first game in the
+  //current range, with numThreads threads each iterating over their own games. Calls consume on the calling thread
+  //with the positions in blocks of one game at a time, in order of games. The result depends only on the seed drawn
+  //from this iterator's random state, not on numThreads.
+  void computeAllMoveFeatures(ArimaaFeatureSet afset, int numThreads, const function<void(const FeatureMatches&)>& consume);
 
   //Return a vector indicating any moves that seem to be obviously bad play and should be filtered
   //hist should be the board history constructed directly from the game record
@@ -61,6 +113,7 @@ class GameIterator
 
   private:
   bool nextHelper();
+  int genNextMoves(Board& b, move_t recordedMove, move_t& nextMove);
 
 };
 
@@ -11,12 +11,14 @@
 #include <algorithm>
 #include <cmath>
 #include <vector>
+#include <thread>
 #include "global.h"
 #include "gameiterator.h"
 #include "feature.h"
 #include "featurearimaa.h"
 #include "featuremove.h"
 #include "learner.h"
+#include "featurecache.h"
 #include "arimaaio.h"
 
 using namespace std;
@@ -58,14 +60,14 @@ void NaiveBayes::train(GameIterator& iter)
   cout << "Training NaiveBayes" << endl;
 
   int numTrained = 0;
+  int winningTeam;
+  vector<vector<findex_t> > teams;
   while(iter.next())
   {
     if(numTrained%1000 == 0)
       cout << "Training NB: " << numTrained << endl;
     numTrained++;
 
-    int winningTeam;
-		vector<vector<findex_t> > teams;
 		iter.computeMoveFeatures(afset, winningTeam,teams);
 
 		int size = teams.size();
@@ -169,7 +171,7 @@ NaiveBayes NaiveBayes::inputFromFile(ArimaaFeatureSet afset, const char* file)
 //-------------------------------------------------------------------------------------------
 
 BradleyTerry::BradleyTerry(ArimaaFeatureSet afset, int numIterations)
-:afset(afset), numIterations(numIterations)
+:afset(afset), numIterations(numIterations), trainAlgorithm(TRAIN_GRADIENT), numThreads(1)
 {
 	numFeatures = afset.fset->numFeatures;
   gamma.resize(numFeatures);
@@ -181,6 +183,24 @@ BradleyTerry::BradleyTerry(ArimaaFeatureSet afset, int numIterations)
   	logGamma[i] = 0;
 }
 
+BradleyTerry::BradleyTerry(ArimaaFeatureSet afset, int numIterations, int trainAlgorithm, int numThreads)
+:afset(afset), numIterations(numIterations), trainAlgorithm(trainAlgorithm), numThreads(numThreads)
+{
+	if(trainAlgorithm != TRAIN_GRADIENT && trainAlgorithm != TRAIN_MM)
+		Global::fatalError("BradleyTerry: unknown training algorithm " + Global::intToString(trainAlgorithm));
+	if(numThreads <= 0)
+		Global::fatalError("BradleyTerry: numThreads must be positive");
+
+	numFeatures = afset.fset->numFeatures;
+  gamma.resize(numFeatures);
+  logGamma.resize(numFeatures);
+
+  for(int i = 0; i<numFeatures; i++)
+    gamma[i] = 1;
+  for(int i = 0; i<numFeatures; i++)
+  	logGamma[i] = 0;
+}
+
 BradleyTerry::~BradleyTerry()
 {
 
@@ -323,34 +343,59 @@ struct MTDByteStream
 	}
 };
 
-static double computeLogProb(const vector<vector<double> >& matchTeamStrength, const vector<int>& matchWinners,
-		const vector<double>& matchWeight)
+//Per-match state during gradient training. Alongside the strength of every team, keeps each match's total strength
+//and weighted log probability, so that changing one feature only needs to revisit the matches it appears in.
+struct BTMatchState
+{
+	vector<vector<double> > teamLogStrength;
+	vector<vector<double> > teamStrength;
+	vector<double> totalStrength;
+	vector<double> logProb;
+};
+
+//Recompute the total strength and log prob of match m from its team strengths, returning the change in its log prob
+static double recomputeMatchLogProb(BTMatchState& state, int m, const vector<int>& matchWinners, const vector<double>& matchWeight)
+{
+	const vector<double>& teamStrength = state.teamStrength[m];
+	double winLogProb = log(teamStrength[matchWinners[m]]);
+	double loseLogProb = -log(state.totalStrength[m]);
+	double logProb = matchWeight[m] * (winLogProb + loseLogProb);
+	double delta = logProb - state.logProb[m];
+	state.logProb[m] = logProb;
+	return delta;
+}
+
+//Recompute the total strength and log prob of every match from scratch, returning the total log prob
+static double computeLogProb(BTMatchState& state, const vector<int>& matchWinners, const vector<double>& matchWeight)
 {
-	int numMatches = (int)matchTeamStrength.size();
+	int numMatches = (int)state.teamStrength.size();
 	double logProbSum = 0.0;
 	for(int m = 0; m<numMatches; m++)
 	{
-		const vector<double>& teamStrength = matchTeamStrength[m];
-
-		double winLogProb = log(teamStrength[matchWinners[m]]);
-
+		const vector<double>& teamStrength = state.teamStrength[m];
 		int numTeams = (int)teamStrength.size();
 		double totalStrength = 0.0;
 		for(int t = 0; t<numTeams; t++)
 			totalStrength += teamStrength[t];
+		state.totalStrength[m] = totalStrength;
 
-		double loseLogProb = -log(totalStrength);
-		logProbSum += matchWeight[m] * (winLogProb + loseLogProb);
+		recomputeMatchLogProb(state,m,matchWinners,matchWeight);
+		logProbSum += state.logProb[m];
 	}
 	return logProbSum;
 }
 
-static void updateLogGamma(findex_t feature, double deltaLogGamma, const vector<int>& matchNumTeams,
-		vector<MTDByteStream>& featureMatchTeams, vector<vector<double> >& matchTeamLogStrength,
-		vector<vector<double> >& matchTeamStrength)
+//Add deltaLogGamma to the feature's log gamma in every match and team it appears in, updating only those matches.
+//Returns the change in the total log prob.
+static double updateLogGamma(findex_t feature, double deltaLogGamma, const vector<int>& matchNumTeams,
+		const vector<int>& matchWinners, const vector<double>& matchWeight,
+		vector<MTDByteStream>& featureMatchTeams, BTMatchState& state)
 {
 	MTDByteStream& matchTeamList = featureMatchTeams[feature];
 
+	//The list is in increasing order of match, so each match's entries are consecutive
+	double deltaLogProb = 0.0;
+	int prevMatch = -1;
 	matchTeamList.resetRead();
 	while(matchTeamList.canRead())
 	{
@@ -360,11 +405,23 @@ static void updateLogGamma(findex_t feature, double deltaLogGamma, const vector<
 		int degree = mtd.degree;
 		DEBUGASSERT(match >= 0);
 		DEBUGASSERT(team >= 0);
-		DEBUGASSERT(match < (int)matchTeamLogStrength.size());
-		DEBUGASSERT(team < (int)matchTeamLogStrength[match].size());
-		matchTeamLogStrength[match][team] += deltaLogGamma * degree;
-		matchTeamStrength[match][team] = exp(matchTeamLogStrength[match][team]);
+		DEBUGASSERT(match < (int)state.teamLogStrength.size());
+		DEBUGASSERT(team < (int)state.teamLogStrength[match].size());
+		DEBUGASSERT(match >= prevMatch);
+
+		if(match != prevMatch && prevMatch != -1)
+			deltaLogProb += recomputeMatchLogProb(state,prevMatch,matchWinners,matchWeight);
+		prevMatch = match;
+
+		double oldStrength = state.teamStrength[match][team];
+		state.teamLogStrength[match][team] += deltaLogGamma * degree;
+		state.teamStrength[match][team] = exp(state.teamLogStrength[match][team]);
+		state.totalStrength[match] += state.teamStrength[match][team] - oldStrength;
 	}
+	if(prevMatch != -1)
+		deltaLogProb += recomputeMatchLogProb(state,prevMatch,matchWinners,matchWeight);
+
+	return deltaLogProb;
 }
 
 static vector<double> trainGradientHelper(ArimaaFeatureSet afset, int numIters, vector<MTDByteStream>& featureMatchTeams,
@@ -378,19 +435,16 @@ static vector<double> trainGradientHelper(ArimaaFeatureSet afset, int numIters,
 	vector<double> logGamma;
 	logGamma.resize(numFeatures,0.0);
 
-	vector<vector<double> > matchTeamLogStrength;
-	vector<vector<double> > matchTeamStrength;
-	matchTeamLogStrength.reserve(numMatches);
+	BTMatchState state;
+	state.teamLogStrength.resize(numMatches);
+	state.teamStrength.resize(numMatches);
+	state.totalStrength.resize(numMatches,0.0);
+	state.logProb.resize(numMatches,0.0);
 	for(int m = 0; m<numMatches; m++)
 	{
 		int numTeams = matchNumTeams[m];
-		vector<double> teamLogStrength;
-		vector<double> teamStrength;
-		teamLogStrength.resize(numTeams,0.0);
-		teamStrength.resize(numTeams,1.0);
-
-		matchTeamLogStrength.push_back(teamLogStrength);
-		matchTeamStrength.push_back(teamStrength);
+		state.teamLogStrength[m].resize(numTeams,0.0);
+		state.teamStrength[m].resize(numTeams,1.0);
 	}
 
 	vector<double> deltaSize;
@@ -401,9 +455,11 @@ static vector<double> trainGradientHelper(ArimaaFeatureSet afset, int numIters,
 	lastType.resize(numFeatures);
 	deltaSize.resize(numFeatures,1.0);
 
-	double logProb = computeLogProb(matchTeamStrength,matchWinners,matchWeight);
+	double logProb = 0.0;
 	for(int iter = 0; iter < numIters; iter++)
 	{
+		//Recompute from scratch each iteration so that rounding in the incremental updates doesn't accumulate
+		logProb = computeLogProb(state,matchWinners,matchWeight);
 		cout << "Training BT iteration " << iter << "/" << numIters << " logProb " << logProb << endl;
 		for(int f = 0; f<numFeatures; f++)
 		{
@@ -411,13 +467,12 @@ static vector<double> trainGradientHelper(ArimaaFeatureSet afset, int numIters,
 				continue;
 
 			//Twiddle the feature positive to see if the log prob improves
-			updateLogGamma(f,deltaSize[f],matchNumTeams,featureMatchTeams,matchTeamLogStrength,matchTeamStrength);
-			double logProbPos = computeLogProb(matchTeamStrength,matchWinners,matchWeight);
+			double deltaPos = updateLogGamma(f,deltaSize[f],matchNumTeams,matchWinners,matchWeight,featureMatchTeams,state);
 
-			if(logProbPos > logProb)
+			if(deltaPos > 0)
 			{
 				logGamma[f] += deltaSize[f];
-				logProb = logProbPos;
+				logProb += deltaPos;
 				cout << f << " " << afset.fset->getName(f) << " " << logGamma[f] << " [+" << deltaSize[f] << "] logProb " << logProb << endl;
 
 				if(lastType[f] == LAST_POS)
@@ -429,13 +484,12 @@ static vector<double> trainGradientHelper(ArimaaFeatureSet afset, int numIters,
 			}
 
 			//Twiddle the feature negative to see if the log prob improves
-			updateLogGamma(f,-2.0*deltaSize[f],matchNumTeams,featureMatchTeams,matchTeamLogStrength,matchTeamStrength);
-			double logProbNeg = computeLogProb(matchTeamStrength,matchWinners,matchWeight);
+			double deltaNeg = deltaPos + updateLogGamma(f,-2.0*deltaSize[f],matchNumTeams,matchWinners,matchWeight,featureMatchTeams,state);
 
-			if(logProbNeg > logProb)
+			if(deltaNeg > 0)
 			{
 				logGamma[f] -= deltaSize[f];
-				logProb = logProbNeg;
+				logProb += deltaNeg;
 				cout << f << " " << afset.fset->getName(f) << " " << logGamma[f] << " [-" << deltaSize[f] << "] logProb " << logProb << endl;
 
 				if(lastType[f] == LAST_NEG)
@@ -447,7 +501,7 @@ static vector<double> trainGradientHelper(ArimaaFeatureSet afset, int numIters,
 			}
 
 			//Restore old feature value
-			updateLogGamma(f,deltaSize[f],matchNumTeams,featureMatchTeams,matchTeamLogStrength,matchTeamStrength);
+			updateLogGamma(f,deltaSize[f],matchNumTeams,matchWinners,matchWeight,featureMatchTeams,state);
 
 			cout << f << " " << afset.fset->getName(f) << " " << logGamma[f] << " [!" << deltaSize[f] << "] logProb " << logProb << endl;
 			deltaSize[f] *= 0.6;
@@ -497,8 +551,269 @@ static void addPrior(ArimaaFeatureSet afset, vector<int>& matchWinners,
 	}
 }
 
+//MINORIZATION-MAXIMIZATION-------------------------------------------------------------
+
+//Matches stored team by team for MM training, with each team as the list of its features, a feature appearing
+//more than once if its degree is more than one
+struct BTTeamMatches
+{
+	vector<int> winners;
+	vector<double> weights;
+	vector<int> matchTeamStart;   //Index of the first team of each match, with one more entry at the end
+	vector<int> teamFeatureStart; //Index of the first feature of each team, with one more entry at the end
+	vector<findex_t> features;
+
+	BTTeamMatches()
+	{
+		matchTeamStart.push_back(0);
+		teamFeatureStart.push_back(0);
+	}
+
+	int numMatches() const
+	{
+		return winners.size();
+	}
+
+	void addMatch(const vector<vector<findex_t> >& teams, int winner, double weight)
+	{
+		winners.push_back(winner);
+		weights.push_back(weight);
+		int numTeams = teams.size();
+		for(int t = 0; t<numTeams; t++)
+		{
+			features.insert(features.end(),teams[t].begin(),teams[t].end());
+			teamFeatureStart.push_back(features.size());
+		}
+		matchTeamStart.push_back(teamFeatureStart.size()-1);
+	}
+
+	void addMatches(const FeatureMatches& block, double weight)
+	{
+		int featureOffset = features.size();
+		int teamOffset = teamFeatureStart.size()-1;
+		int numBlockMatches = block.numMatches();
+		winners.insert(winners.end(),block.winners.begin(),block.winners.end());
+		weights.insert(weights.end(),numBlockMatches,weight);
+		features.insert(features.end(),block.features.begin(),block.features.end());
+		for(int i = 1; i<(int)block.teamFeatureStart.size(); i++)
+			teamFeatureStart.push_back(block.teamFeatureStart[i] + featureOffset);
+		for(int m = 1; m<=numBlockMatches; m++)
+			matchTeamStart.push_back(block.matchTeamStart[m] + teamOffset);
+	}
+};
+
+static void addPrior(ArimaaFeatureSet afset, BTTeamMatches& matches, vector<bool>& isUnused)
+{
+	const vector<FeatureSet::PriorMatch> pMatches = afset.fset->getPriorMatches();
+	int priorIndex = afset.fset->priorIndex;
+
+	int numMatches = pMatches.size();
+	vector<vector<findex_t> > teams(2);
+	for(int i = 0; i<numMatches; i++)
+	{
+		teams[0].assign(1,pMatches[i].winner);
+		teams[1].assign(1,pMatches[i].loser);
+		matches.addMatch(teams,0,pMatches[i].weight);
+
+		if(pMatches[i].winner != priorIndex && pMatches[i].loser != priorIndex)
+		{
+			isUnused[pMatches[i].winner] = false;
+			isUnused[pMatches[i].loser] = false;
+		}
+	}
+}
+
+static void addMatchMarkUsed(BTTeamMatches& matches, const vector<vector<findex_t> >& teams, int winner, vector<bool>& isUnused)
+{
+	matches.addMatch(teams,winner,1.0);
+	int numTeams = teams.size();
+	for(int t = 0; t<numTeams; t++)
+		for(int i = 0; i<(int)teams[t].size(); i++)
+			isUnused[teams[t][i]] = false;
+}
+
+//Run f(thread,matchStart,matchEnd) over numThreads contiguous shards of the matches in parallel
+template <typename Func>
+static void forEachMatchShard(int numMatches, int numThreads, Func f)
+{
+	vector<std::thread> threads;
+	for(int t = 1; t<numThreads; t++)
+		threads.push_back(std::thread(f,t,(int)((int64_t)numMatches*t/numThreads),(int)((int64_t)numMatches*(t+1)/numThreads)));
+	f(0,0,(int)((int64_t)numMatches/numThreads));
+	for(int t = 0; t<(int)threads.size(); t++)
+		threads[t].join();
+}
+
+//Compute the strength of each team in match m into teamStrength, returning the total
+static double computeTeamStrengths(const BTTeamMatches& matches, int m, const vector<double>& logGamma, vector<double>& teamStrength)
+{
+	int teamStart = matches.matchTeamStart[m];
+	int numTeams = matches.matchTeamStart[m+1] - teamStart;
+	teamStrength.resize(numTeams);
+	double total = 0.0;
+	for(int t = 0; t<numTeams; t++)
+	{
+		double logStrength = 0.0;
+		int end = matches.teamFeatureStart[teamStart+t+1];
+		for(int i = matches.teamFeatureStart[teamStart+t]; i<end; i++)
+			logStrength += logGamma[matches.features[i]];
+		teamStrength[t] = exp(logStrength);
+		total += teamStrength[t];
+	}
+	return total;
+}
+
+static double computeLogProbMM(const BTTeamMatches& matches, const vector<double>& logGamma, int numThreads)
+{
+	int numMatches = matches.numMatches();
+	vector<double> threadLogProb(numThreads,0.0);
+	forEachMatchShard(numMatches,numThreads,[&](int thread, int start, int end) {
+		vector<double> teamStrength;
+		double logProb = 0.0;
+		for(int m = start; m<end; m++)
+		{
+			double total = computeTeamStrengths(matches,m,logGamma,teamStrength);
+			logProb += matches.weights[m] * (log(teamStrength[matches.winners[m]]) - log(total));
+		}
+		threadLogProb[thread] = logProb;
+	});
+
+	double logProb = 0.0;
+	for(int t = 0; t<numThreads; t++)
+		logProb += threadLogProb[t];
+	return logProb;
+}
+
+//Generalized Bradley-Terry by minorization-maximization (Hunter 2004, Coulom 2007). Each feature group in turn gets
+//gamma_i = W_i / sum_j w_j C_ij / E_j, where W_i is the weighted number of times i appears in a winning team, E_j is
+//the total strength of match j and C_ij is the total strength of the teams of j containing i divided by gamma_i,
+//counted once per time i appears. The denominators are summed over disjoint shards of the matches in parallel
+//and then reduced in a fixed order, so results depend only on the number of threads. The features of a group are
+//updated together, which is exact MM when no team has two features of the same group, and otherwise still has
+//the maximum likelihood as its fixed point.
+static vector<double> trainMMHelper(ArimaaFeatureSet afset, int numIters, int numThreads, const BTTeamMatches& matches,
+		const vector<bool>& isUnused)
+{
+	const FeatureSet& fset = *afset.fset;
+	int numFeatures = fset.numFeatures;
+	int numMatches = matches.numMatches();
+	int priorIndex = fset.priorIndex;
+
+	vector<double> logGamma;
+	logGamma.resize(numFeatures,0.0);
+
+	//Weighted number of wins of each feature, which doesn't change
+	vector<double> wins;
+	wins.resize(numFeatures,0.0);
+	for(int m = 0; m<numMatches; m++)
+	{
+		int team = matches.matchTeamStart[m] + matches.winners[m];
+		int end = matches.teamFeatureStart[team+1];
+		for(int i = matches.teamFeatureStart[team]; i<end; i++)
+			wins[matches.features[i]] += matches.weights[m];
+	}
+
+	//A feature with no wins would go to zero strength, so leave it alone, which the prior normally prevents anyways
+	vector<bool> isUpdated;
+	isUpdated.resize(numFeatures,false);
+	for(int f = 0; f<numFeatures; f++)
+		isUpdated[f] = (f != priorIndex && !isUnused[f] && wins[f] > 0);
+
+	vector<vector<double> > threadDenoms(numThreads);
+	for(int iter = 0; iter < numIters; iter++)
+	{
+		cout << "Training BT MM iteration " << iter << "/" << numIters << " logProb " << computeLogProbMM(matches,logGamma,numThreads) << endl;
+
+		int numGroups = fset.groups.size();
+		for(int g = 0; g<numGroups; g++)
+		{
+			int base = fset.groups[g].baseIdx;
+			int size = fset.groups[g].size;
+			bool anyUpdated = false;
+			for(int f = base; f<base+size; f++)
+				anyUpdated = anyUpdated || isUpdated[f];
+			if(!anyUpdated)
+				continue;
+
+			vector<double> groupGamma(size);
+			for(int f = base; f<base+size; f++)
+				groupGamma[f-base] = exp(logGamma[f]);
+
+			forEachMatchShard(numMatches,numThreads,[&](int thread, int start, int end) {
+				vector<double>& denom = threadDenoms[thread];
+				denom.assign(size,0.0);
+				vector<double> teamStrength;
+				for(int m = start; m<end; m++)
+				{
+					double total = computeTeamStrengths(matches,m,logGamma,teamStrength);
+					double scale = matches.weights[m] / total;
+					int teamStart = matches.matchTeamStart[m];
+					int numTeams = matches.matchTeamStart[m+1] - teamStart;
+					for(int t = 0; t<numTeams; t++)
+					{
+						int fEnd = matches.teamFeatureStart[teamStart+t+1];
+						for(int i = matches.teamFeatureStart[teamStart+t]; i<fEnd; i++)
+						{
+							findex_t f = matches.features[i];
+							if(f >= base && f < base+size)
+								denom[f-base] += scale * teamStrength[t] / groupGamma[f-base];
+						}
+					}
+				}
+			});
+
+			for(int f = base; f<base+size; f++)
+			{
+				if(!isUpdated[f])
+					continue;
+				double denom = 0.0;
+				for(int t = 0; t<numThreads; t++)
+					denom += threadDenoms[t][f-base];
+				if(denom > 0)
+					logGamma[f] = log(wins[f] / denom);
+			}
+		}
+	}
+	cout << "Training BT MM done, logProb " << computeLogProbMM(matches,logGamma,numThreads) << endl;
+
+	return logGamma;
+}
+
 void BradleyTerry::train(GameIterator& iter)
 {
+	train([&](const function<void(const FeatureMatches&)>& consume) {
+		iter.computeAllMoveFeatures(afset,numThreads,consume);
+	});
+}
+
+void BradleyTerry::trainFromCache(const string& cacheFile)
+{
+	train([&](const function<void(const FeatureMatches&)>& consume) {
+		FeatureCache::read(cacheFile,afset,consume);
+	});
+}
+
+void BradleyTerry::train(const function<void(const function<void(const FeatureMatches&)>&)>& produce)
+{
+	if(trainAlgorithm == TRAIN_MM)
+	{
+		vector<bool> isUnused;
+		isUnused.resize(numFeatures,true);
+		BTTeamMatches matches;
+		addPrior(afset,matches,isUnused);
+
+		produce([&](const FeatureMatches& block) {
+			matches.addMatches(block,1.0);
+			for(int i = 0; i<(int)block.features.size(); i++)
+				isUnused[block.features[i]] = false;
+		});
+
+		logGamma = trainMMHelper(afset,numIterations,numThreads,matches,isUnused);
+		for(int i = 0; i<numFeatures; i++)
+			gamma[i] = exp(logGamma[i]);
+		return;
+	}
+
 	vector<bool> isUnused;
 	vector<int> matchWinners;
 	vector<int> matchNumTeams;
@@ -511,32 +826,32 @@ void BradleyTerry::train(GameIterator& iter)
 	addPrior(afset,matchWinners,matchNumTeams,matchWeight,featureMatchTeams,isUnused);
 	match = matchWinners.size();
 
-	int winningTeam;
-	vector<vector<findex_t> > teams;
-  while(iter.next())
-  {
-		iter.computeMoveFeatures(afset,winningTeam,teams);
-		matchWinners.push_back(winningTeam);
-		matchNumTeams.push_back((int)teams.size());
-		matchWeight.push_back(1.0);
-
-		int numTeams = teams.size();
-		for(int t = 0; t<numTeams; t++)
+	produce([&](const FeatureMatches& block) {
+		int numBlockMatches = block.numMatches();
+		for(int m = 0; m<numBlockMatches; m++)
 		{
-			const vector<findex_t>& members = teams[t];
-			int numMembers = members.size();
-			for(int i = 0; i<numMembers; i++)
+			int numTeams = block.numTeams(m);
+			matchWinners.push_back(block.winners[m]);
+			matchNumTeams.push_back(numTeams);
+			matchWeight.push_back(1.0);
+
+			int teamStart = block.matchTeamStart[m];
+			for(int t = 0; t<numTeams; t++)
 			{
-				MTD mtd;
-				mtd.match = match;
-				mtd.team = t;
-				mtd.degree = 1;
-				featureMatchTeams[members[i]].write(mtd,matchNumTeams);
-				isUnused[members[i]]= false;
+				int fEnd = block.teamFeatureStart[teamStart+t+1];
+				for(int i = block.teamFeatureStart[teamStart+t]; i<fEnd; i++)
+				{
+					MTD mtd;
+					mtd.match = match;
+					mtd.team = t;
+					mtd.degree = 1;
+					featureMatchTeams[block.features[i]].write(mtd,matchNumTeams);
+					isUnused[block.features[i]] = false;
+				}
 			}
+			match++;
 		}
-		match++;
-  }
+	});
 
 	logGamma = trainGradientHelper(afset,numIterations,featureMatchTeams,matchNumTeams,matchWinners,matchWeight,isUnused);
 	for(int i = 0; i<numFeatures; i++)
@@ -546,6 +861,23 @@ void BradleyTerry::train(GameIterator& iter)
 
 void BradleyTerry::train(const vector<vector<vector<findex_t> > >& matches, const vector<int>& winners)
 {
+	if(trainAlgorithm == TRAIN_MM)
+	{
+		vector<bool> isUnused;
+		isUnused.resize(numFeatures,true);
+		BTTeamMatches teamMatches;
+		addPrior(afset,teamMatches,isUnused);
+
+		int numMatches = matches.size();
+		for(int m = 0; m<numMatches; m++)
+			addMatchMarkUsed(teamMatches,matches[m],winners[m],isUnused);
+
+		logGamma = trainMMHelper(afset,numIterations,numThreads,teamMatches,isUnused);
+		for(int i = 0; i<numFeatures; i++)
+			gamma[i] = exp(logGamma[i]);
+		return;
+	}
+
 	vector<bool> isUnused;
 	vector<int> matchWinners;
 	vector<int> matchNumTeams;
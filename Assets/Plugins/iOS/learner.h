@@ -8,6 +8,8 @@
 #define LEARNER_H
 
 #include <vector>
+#include <string>
+#include <functional>
 #include "gameiterator.h"
 #include "feature.h"
 
@@ -64,12 +66,21 @@ class BradleyTerry : public Learner
   int numFeatures;
   int numIterations;
 
+  //Training algorithms
+  static const int TRAIN_GRADIENT = 0; //Coordinate search, twiddling one feature at a time by an adaptive step
+  static const int TRAIN_MM = 1;       //Minorization-maximization by feature group, parallel over shards of matches
+  int trainAlgorithm;
+  int numThreads;                      //Threads to use for TRAIN_MM and for computing features from games
+
   BradleyTerry(ArimaaFeatureSet afset, int numIterations);
+  BradleyTerry(ArimaaFeatureSet afset, int numIterations, int trainAlgorithm, int numThreads);
 
   ~BradleyTerry();
 
   void train(GameIterator& iter);
   void train(const vector<vector<vector<findex_t> > >& matches, const vector<int>& winners);
+  //Train on the matches of a file written by FeatureCache::build
+  void trainFromCache(const string& cacheFile);
 
   double evaluate(const vector<findex_t>& team);
   void outputToFile(const char* file);
@@ -79,6 +90,10 @@ class BradleyTerry : public Learner
 
   void outputLogsToFile(const char* file);
 
+  private:
+  //Train on the matches that produce passes to the function it is given, one block of matches at a time
+  void train(const function<void(const function<void(const FeatureMatches&)>&)>& produce);
+
 };
 
 /*
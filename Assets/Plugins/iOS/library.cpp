@@ -6,6 +6,10 @@
 #include <ctime>
 #include <cstdlib>
 #include <cstring>  // for strerror
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 #include "global.h"
 #include "rand.h"
 #include "board.h"
@@ -20,19 +24,49 @@
 #include "main.h"
 #include "library.h"
 
-static bool initialized = false;
-static bool running = false;
+//One engine per game. Each owns its own searcher (and therefore hashtables) and rng, so that separate
+//engines can be used simultaneously from different threads.
+struct Engine
+{
+    Searcher* searcher;
+    Rand rand;
+    std::atomic<bool> running;
 
-static Searcher* searcher;
+    //The game so far, so that each call only has to parse and play the moves made since the last one
+    ArimaaIO::IncrementalMoveReader gameReader;
 
-static void Initialize()
-{
-	if (initialized) return;
-	initialized = true;
+    //Pondering - searching the predicted position while the opponent thinks
+    move_t predictedReply;          //Opponent reply from the pv of our last search
+    int lastDifficulty;             //Difficulty of our last search, used to configure the ponder
+    bool pondering;                 //Is there a ponder search, running or finished, not yet collected?
+    Board ponderBoard;              //The position being pondered
+    std::thread ponderThread;
+    std::atomic<bool> ponderDone;   //Has the ponder search returned?
+
+    Engine(uint64_t seed);
+    ~Engine();
+};
+
+static std::once_flag initFlag;
+static std::mutex globalRandMutex; //Rand::rand is not threadsafe, guards seeding new engines
+
+//Engine used by the single-game InitBot/MoveBot interface
+static Engine* defaultEngine = NULL;
+
+static void StopPonder(Engine* engine);
 
-	bool isDev = false;
-	Init::init(isDev);
+static void InitializeGlobal()
+{
+	std::call_once(initFlag, []()
+	{
+		bool isDev = false;
+		Init::init(isDev);
+	});
+}
 
+Engine::Engine(uint64_t seed)
+	:rand(seed),running(false),predictedReply(ERRORMOVE),lastDifficulty(-1),pondering(false),ponderDone(false)
+{
     ArimaaFeatureSet arimaFeatureSet = MoveFeature::getArimaaFeatureSet();
     BradleyTerry learner = BradleyTerry::inputFromDefault(arimaFeatureSet);
 	
@@ -42,71 +76,48 @@ static void Initialize()
 	params.numThreads = 1;
 	params.mainHashExp = 19;
 	params.fullMoveHashExp = 18;
+	params.evalCacheExp = 16; //1MB, many engines can be alive at once and only a few percent of evals hit anyways
 	params.initRootMoveFeatures(learner);
 	params.setRootFancyPrune(true);
 	params.useEvalParams = true;
 	params.evalParams = EvalParams();
-	params.setRandomize(true, 20, Rand::rand.nextUInt64());
+	params.setRandomize(true, 20, rand.nextUInt64());
 	
     searcher = new Searcher(params);
 }
-static const char* Move(const char* moveJString, int difficultyJ)
-{
-    if (!initialized) Initialize();
-    if (running) return ("Already running!");
-    running = true;
-
-    const char* moveStringBuf = moveJString;
-    if (moveStringBuf == NULL) return NULL; /* OutOfMemoryError */
-    
-    string moveString = string(moveStringBuf);
-    
-    int difficulty = difficultyJ;
-    if (difficulty < 0) difficulty = 0;
-    if (difficulty > 10) difficulty = 10;
 
-    Board board;
-    BoardHistory hist;
-    GameRecord record = ArimaaIO::readMoves(moveString);
-    hist = BoardHistory(record);
-    board = hist.turnBoard[hist.maxTurnNumber];
+Engine::~Engine()
+{
+    StopPonder(this);
+    delete searcher;
+}
 
-    //Setup!
-    if (board.pieceCounts[0][0] == 0 || board.pieceCounts[1][0] == 0)
+static Engine* CreateEngineInternal()
+{
+    InitializeGlobal();
+    uint64_t seed;
     {
-        int pr = 1;
-        int rr = 1;
-        int no = 1;
-        switch (difficulty)
-        {
-        case 0:  pr = 3; rr = 1; no = 0; break;
-        case 1:  pr = 1; rr = 1; no = 0; break;
-        case 2:  pr = 1; rr = 3; no = 0; break;
-        case 3:  pr = 1; rr = 4; no = 2; break;
-        case 4:  pr = 0; rr = 3; no = 2; break;
-        case 5:  pr = 0; rr = 1; no = 2; break;
-        case 6:  pr = 0; rr = 1; no = 5; break;
-        default: pr = 0; rr = 0; no = 1; break;
-        }
-        int rand = Rand::rand.nextUInt(pr + rr + no);
-        if (rand < pr) Setup::setupPartialRandom(board, Rand::rand.nextInt());
-        else if (rand < pr + rr) Setup::setupRatedRandom(board, Rand::rand.nextInt());
-        else Setup::setupNormal(board, Rand::rand.nextInt());
-
-        string placements = ArimaaIO::writePlacements(board, OPP(board.player));
-        //placements = "\n" + placements;
-        running = false;
-        
-        char* returnValue = new char[placements.length() + 1];
-        strncpy(returnValue, placements.c_str(), placements.length() + 1);
-        returnValue[placements.length()] = '\0';
-        return returnValue;
+        std::lock_guard<std::mutex> lock(globalRandMutex);
+        seed = Rand::rand.nextUInt64();
     }
+    return new Engine(seed);
+}
 
-    int maxDepth = 5;
-    double hardMinSecs = 0.2;
-    double targetSecs = 0.4;
-    double hardMaxSecs = 0.8;
+static void Initialize()
+{
+    InitializeGlobal();
+    std::lock_guard<std::mutex> lock(globalRandMutex);
+    if (defaultEngine != NULL) return;
+    defaultEngine = new Engine(Rand::rand.nextUInt64());
+}
+
+//Set up the searcher parameters and time limits for the given difficulty
+static void ConfigureSearch(int difficulty, Rand& rand, SearchParams& params, int& maxDepth, double& hardMinSecs, double& targetSecs, double& hardMaxSecs)
+{
+    maxDepth = 5;
+    hardMinSecs = 0.2;
+    targetSecs = 0.4;
+    hardMaxSecs = 0.8;
     int randomStdev = 20;
     bool stupidPrune = false;
     bool fixedPrune = false;
@@ -134,13 +145,13 @@ static const char* Move(const char* moveJString, int difficultyJ)
         otherStupidThings = true; break;
     case 2: maxDepth = 4; hardMinSecs = 0.0; targetSecs = 0.01; hardMaxSecs = 1; randomStdev = 1000; stupidPrune = true; pruneAllBut = 0.65;
         enableQSearch = false; evalCapScaleFactor = 0.0; tcScoreScaleFactor = 0.00; rabYDistFactor = 0.1; newRecklessScale = 2.0;
-        enableGoalTree = Rand::rand.nextUInt(10) <= 7;
+        enableGoalTree = rand.nextUInt(10) <= 7;
         otherBadThings = true; break;
     case 3: maxDepth = 4; hardMinSecs = 0.0; targetSecs = 0.01; hardMaxSecs = 1; randomStdev = 700; stupidPrune = true; pruneAllBut = 0.90;
         enableQSearch = false; evalCapScaleFactor = 0.01; tcScoreScaleFactor = 0.10; rabYDistFactor = 0.2; newRecklessScale = 1.5;
         otherSillyThings = true; break;
     case 4: maxDepth = 4; hardMinSecs = 0.0; targetSecs = 0.01; hardMaxSecs = 1; randomStdev = 480;
-        enableQSearch = false; evalCapScaleFactor = 0.08 + (Rand::rand.nextUInt(5) >= 3 ? 0.1 : 0.0); tcScoreScaleFactor = 0.23; rabYDistFactor = 0.4; newRecklessScale = 1.2; break;
+        enableQSearch = false; evalCapScaleFactor = 0.08 + (rand.nextUInt(5) >= 3 ? 0.1 : 0.0); tcScoreScaleFactor = 0.23; rabYDistFactor = 0.4; newRecklessScale = 1.2; break;
     case 5: maxDepth = 4; hardMinSecs = 0.0; targetSecs = 0.01; hardMaxSecs = 1; randomStdev = 380;
         enableQSearch = false; evalCapScaleFactor = 0.55; tcScoreScaleFactor = 0.29; rabYDistFactor = 0.6; newRecklessScale = 0.7; break;
     case 6: maxDepth = 4; hardMinSecs = 0.0; targetSecs = 0.01; hardMaxSecs = 1; randomStdev = 280;
@@ -152,69 +163,220 @@ static const char* Move(const char* moveJString, int difficultyJ)
     case 10: maxDepth = 24; hardMinSecs = 13.0; targetSecs = 20.00; hardMaxSecs = 30; randomStdev = 40; break;
     }
 
-    if (stupidPrune) searcher->params.setStupidPrune(true, pruneAllBut);
-    else if (fixedPrune) searcher->params.setRootFixedPrune(true, pruneAllBut, false);
-    else searcher->params.setRootFancyPrune(true);
+    if (stupidPrune) params.setStupidPrune(true, pruneAllBut);
+    else if (fixedPrune) params.setRootFixedPrune(true, pruneAllBut, false);
+    else params.setRootFancyPrune(true);
 
-    searcher->params.qEnable = enableQSearch;
-    searcher->params.enableGoalTree = enableGoalTree;
-    searcher->params.evalParams = EvalParams();
+    params.qEnable = enableQSearch;
+    params.enableGoalTree = enableGoalTree;
+    params.evalParams = EvalParams();
 
-    searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::RECKLESS_ADVANCE_SCALE)] = newRecklessScale;
-    searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::CAP_SCORE_SCALE)] *= evalCapScaleFactor;
-    searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::TC_SCORE_SCALE)] *= tcScoreScaleFactor;
+    params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::RECKLESS_ADVANCE_SCALE)] = newRecklessScale;
+    params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::CAP_SCORE_SCALE)] *= evalCapScaleFactor;
+    params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::TC_SCORE_SCALE)] *= tcScoreScaleFactor;
 
     for (int i = 0; i < 8; i++)
     {
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::RAB_YDIST_VALUES)] *= rabYDistFactor;
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::RAB_YDIST_TC_VALUES)] *= (tcScoreScaleFactor + rabYDistFactor) / 2.0;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::RAB_YDIST_VALUES)] *= rabYDistFactor;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::RAB_YDIST_TC_VALUES)] *= (tcScoreScaleFactor + rabYDistFactor) / 2.0;
     }
 
     if (otherReallyStupidThings)
     {
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::PIECE_SQUARE_SCALE)] = 0.35;
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::TRAPDEF_SCORE_SCALE)] = -0.2;
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::STRAT_SCORE_SCALE)] = 0.0;
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::THREAT_SCORE_SCALE)] = -0.2;
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::RABBIT_SCORE_SCALE)] = 0.0;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::PIECE_SQUARE_SCALE)] = 0.35;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::TRAPDEF_SCORE_SCALE)] = -0.2;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::STRAT_SCORE_SCALE)] = 0.0;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::THREAT_SCORE_SCALE)] = -0.2;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::RABBIT_SCORE_SCALE)] = 0.0;
     }
     else if (otherStupidThings)
     {
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::PIECE_SQUARE_SCALE)] = 0.75;
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::TRAPDEF_SCORE_SCALE)] = 0.2;
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::STRAT_SCORE_SCALE)] = 0.0;
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::THREAT_SCORE_SCALE)] = 0.4;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::PIECE_SQUARE_SCALE)] = 0.75;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::TRAPDEF_SCORE_SCALE)] = 0.2;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::STRAT_SCORE_SCALE)] = 0.0;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::THREAT_SCORE_SCALE)] = 0.4;
     }
     else if (otherBadThings)
     {
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::STRAT_SCORE_SCALE)] = 0.15;
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::THREAT_SCORE_SCALE)] = 0.6;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::STRAT_SCORE_SCALE)] = 0.15;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::THREAT_SCORE_SCALE)] = 0.6;
     }
     else if (otherSillyThings)
     {
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::STRAT_SCORE_SCALE)] = 0.4;
-        searcher->params.evalParams.featureWeights[searcher->params.evalParams.fset.get(EvalParams::THREAT_SCORE_SCALE)] = 0.7;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::STRAT_SCORE_SCALE)] = 0.4;
+        params.evalParams.featureWeights[params.evalParams.fset.get(EvalParams::THREAT_SCORE_SCALE)] = 0.7;
+    }
+
+    params.setRandomize(true, randomStdev, rand.nextUInt64());
+}
+
+//The ponder thread may not have started its clock yet, which would reset any time limits we set on it
+static void WaitForPonderClock(Engine* engine)
+{
+    while (!engine->ponderDone && !engine->searcher->isSearching())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+//Stop any ponder search and discard its result
+static void StopPonder(Engine* engine)
+{
+    if (!engine->pondering) return;
+    WaitForPonderClock(engine);
+    engine->searcher->interruptExternal();
+    engine->ponderThread.join();
+    engine->pondering = false;
+}
+
+//Make sure the default engine's ponder thread is not left running when the library is unloaded
+static struct PonderCleanup { ~PonderCleanup() { if (defaultEngine != NULL) StopPonder(defaultEngine); } } ponderCleanup;
+
+static void PonderSearch(Engine* engine, Board board, BoardHistory hist, int maxDepth)
+{
+    //Unbounded time, runs until told how long to search by a ponder hit, or interrupted on a miss
+    engine->searcher->searchID(board, hist, maxDepth, 0, 0, 0, false);
+    engine->ponderDone = true;
+}
+
+static void Ponder(Engine* engine, const char* moveJString)
+{
+    if (engine == NULL || moveJString == NULL) return;
+    if (engine->running.exchange(true)) return;
+    StopPonder(engine);
+    if (engine->lastDifficulty < 0 || engine->predictedReply == ERRORMOVE) { engine->running = false; return; }
+
+    BoardHistory hist = engine->gameReader.read(string(moveJString));
+    Board board = hist.turnBoard[hist.maxTurnNumber];
+
+    //Make the predicted opponent move, it must be a legal complete turn in this position
+    Board copy = board;
+    if (board.pieceCounts[0][0] == 0 || board.pieceCounts[1][0] == 0 ||
+        !copy.makeMoveLegal(engine->predictedReply) || copy.player == board.player)
+    { engine->running = false; return; }
+    hist.reportMove(copy, engine->predictedReply, board.step);
+
+    int maxDepth;
+    double hardMinSecs;
+    double targetSecs;
+    double hardMaxSecs;
+    ConfigureSearch(engine->lastDifficulty, engine->rand, engine->searcher->params, maxDepth, hardMinSecs, targetSecs, hardMaxSecs);
+
+    engine->ponderBoard = copy;
+    engine->pondering = true;
+    engine->ponderDone = false;
+    engine->ponderThread = std::thread(PonderSearch, engine, copy, hist, maxDepth);
+    engine->running = false;
+}
+
+static string MoveString(Engine* engine, const string& moveString, int difficultyJ)
+{
+    if (engine->running.exchange(true)) return ("Already running!");
+    Searcher* searcher = engine->searcher;
+    Rand& rand = engine->rand;
+    
+    int difficulty = difficultyJ;
+    if (difficulty < 0) difficulty = 0;
+    if (difficulty > 10) difficulty = 10;
+
+    const BoardHistory& hist = engine->gameReader.read(moveString);
+    Board board = hist.turnBoard[hist.maxTurnNumber];
+
+    //Setup!
+    if (board.pieceCounts[0][0] == 0 || board.pieceCounts[1][0] == 0)
+    {
+        StopPonder(engine);
+        int pr = 1;
+        int rr = 1;
+        int no = 1;
+        switch (difficulty)
+        {
+        case 0:  pr = 3; rr = 1; no = 0; break;
+        case 1:  pr = 1; rr = 1; no = 0; break;
+        case 2:  pr = 1; rr = 3; no = 0; break;
+        case 3:  pr = 1; rr = 4; no = 2; break;
+        case 4:  pr = 0; rr = 3; no = 2; break;
+        case 5:  pr = 0; rr = 1; no = 2; break;
+        case 6:  pr = 0; rr = 1; no = 5; break;
+        default: pr = 0; rr = 0; no = 1; break;
+        }
+        int r = rand.nextUInt(pr + rr + no);
+        if (r < pr) Setup::setupPartialRandom(board, rand.nextInt());
+        else if (r < pr + rr) Setup::setupRatedRandom(board, rand.nextInt());
+        else Setup::setupNormal(board, rand.nextInt());
+
+        string placements = ArimaaIO::writePlacements(board, OPP(board.player));
+        //placements = "\n" + placements;
+        engine->running = false;
+        return placements;
     }
 
-    searcher->params.setRandomize(true, randomStdev, Rand::rand.nextUInt64());
-    searcher->searchID(board, hist, maxDepth, hardMinSecs, targetSecs, hardMaxSecs, false);
+    int maxDepth;
+    double hardMinSecs;
+    double targetSecs;
+    double hardMaxSecs;
+
+    //Opponent played the move we pondered on, so just give that search the normal amount of time from now on
+    //The ponder search is still reading the searcher's params, so only compute the time limits here
+    if (engine->pondering && difficulty == engine->lastDifficulty &&
+        board.sitCurrentHash == engine->ponderBoard.sitCurrentHash && board.turnNumber == engine->ponderBoard.turnNumber)
+    {
+        SearchParams unusedParams = searcher->params;
+        ConfigureSearch(difficulty, rand, unusedParams, maxDepth, hardMinSecs, targetSecs, hardMaxSecs);
+        WaitForPonderClock(engine);
+        searcher->setTimeFromNow(hardMinSecs, targetSecs, hardMaxSecs);
+        engine->ponderThread.join();
+        engine->pondering = false;
+    }
+    else
+    {
+        StopPonder(engine);
+        ConfigureSearch(difficulty, rand, searcher->params, maxDepth, hardMinSecs, targetSecs, hardMaxSecs);
+        searcher->searchID(board, hist, maxDepth, hardMinSecs, targetSecs, hardMaxSecs, false);
+    }
+    engine->lastDifficulty = difficulty;
 
     move_t bestMove = searcher->getMove();
     string moveStr = ArimaaIO::writeMove(board, bestMove, false);
-    
-    running = false;
+
+    //Remember what we expect the opponent to do, for pondering
+    vector<move_t> pvMoves = searcher->getIDPVFullMoves();
+    engine->predictedReply = pvMoves.size() >= 2 ? pvMoves[1] : ERRORMOVE;
+
+    engine->running = false;
+    return moveStr;
+}
+
+static const char* Move(Engine* engine, const char* moveJString, int difficultyJ)
+{
+    const char* moveStringBuf = moveJString;
+    if (moveStringBuf == NULL) return NULL; /* OutOfMemoryError */
+
+    string moveStr = MoveString(engine, string(moveStringBuf), difficultyJ);
 
     char* returnValue = new char[moveStr.length() + 1];
     strncpy(returnValue, moveStr.c_str(), moveStr.length() + 1);
     returnValue[moveStr.length()] = '\0';
     return returnValue;
 }
-static void Interrupt() { if(searcher != NULL) { searcher->interruptExternal(); } }
+static void Interrupt(Engine* engine) { if(engine != NULL) { engine->searcher->interruptExternal(); } }
 
 void InitBot() { Initialize(); }
-void InterruptBot() { Interrupt(); }
-void MoveBot(const char* state, int difficulty, char* move, int length) { strncpy(move, Move(state, difficulty), length); }
-const char* MoveBot2(const char* state, int difficulty) { return Move(state, difficulty); }
+void PonderBot(const char* state) { Initialize(); Ponder(defaultEngine, state); }
+void InterruptBot() { Interrupt(defaultEngine); }
+void MoveBot(const char* state, int difficulty, char* move, int length) { Initialize(); strncpy(move, Move(defaultEngine, state, difficulty), length); }
+const char* MoveBot2(const char* state, int difficulty) { Initialize(); return Move(defaultEngine, state, difficulty); }
+
+EngineHandle CreateEngine() { return CreateEngineInternal(); }
+void DestroyEngine(EngineHandle handle) { delete handle; }
+void EngineInterrupt(EngineHandle handle) { Interrupt(handle); }
+void EnginePonder(EngineHandle handle, const char* state) { Ponder(handle, state); }
+double EngineParseSecondsSaved(EngineHandle handle) { return handle == NULL ? 0 : handle->gameReader.getSecondsSaved(); }
+void EngineMove(EngineHandle handle, const char* state, int difficulty, char* move, int length)
+{
+    if (handle == NULL || state == NULL || move == NULL || length <= 0) return;
+    string moveStr = MoveString(handle, string(state), difficulty);
+    strncpy(move, moveStr.c_str(), length);
+    move[length - 1] = '\0';
+}
 
 int main() 
 {
@@ -224,7 +386,7 @@ int main()
 
     const char* result = nullptr;
 
-     result = Move(moveJString, difficultyJ);
+     result = MoveBot2(moveJString, difficultyJ);
      std::cout << "Result: " << result << std::endl;
 
      std::cin.get();
@@ -11,9 +11,24 @@
 #define ARIMAENGINE_API __declspec(dllimport)
 #endif
 
+//Single game interface, using one shared engine----------------------------
 extern "C" void InitBot();
 extern "C" void InterruptBot();
 extern "C" void MoveBot(const char* state, int difficulty, char* move, int length);
 extern "C" const char* MoveBot2(const char* state, int difficulty);
+extern "C" void PonderBot(const char* state);
+
+//Multiple game interface-----------------------------------------------------
+//Each engine owns its own searcher, hashtables and rng. Different engines may be used concurrently from
+//different threads, but calls on any one engine must not overlap (other than EngineInterrupt).
+typedef struct Engine* EngineHandle;
+
+extern "C" EngineHandle CreateEngine();
+extern "C" void DestroyEngine(EngineHandle handle);
+extern "C" void EngineInterrupt(EngineHandle handle);
+extern "C" void EnginePonder(EngineHandle handle, const char* state);
+extern "C" void EngineMove(EngineHandle handle, const char* state, int difficulty, char* move, int length);
+//Estimated seconds of game parsing and replaying saved so far by only reading the moves made since the previous call
+extern "C" double EngineParseSecondsSaved(EngineHandle handle);
 
 #endif
@@ -150,6 +150,13 @@ MainFuncEntry MainFuncs::commandArr[36] =
 {
 		MainFuncEntry("init", MainFuncs::init, "<seed>"),
 		MainFuncEntry("getMove", MainFuncs::getMove, ""),
+		MainFuncEntry("benchThreadScaling", MainFuncs::benchThreadScaling, "<depth> <maxThreads> <optional posFile>"),
+		MainFuncEntry("benchMakeMove", MainFuncs::benchMakeMove, "<reps> <optional posFile>"),
+		MainFuncEntry("benchCompactBoard", MainFuncs::benchCompactBoard, "<reps> <turns> <optional posFile>"),
+		MainFuncEntry("benchEvalMoveGen", MainFuncs::benchEvalMoveGen, "<reps> <optional posFile>"),
+		MainFuncEntry("evalLazyBounds", MainFuncs::evalLazyBounds, "<posFile> <optional evalParamsFile>"),
+		MainFuncEntry("buildFeatureCache", MainFuncs::buildFeatureCache,
+				"<gamesFile> <cacheFile> <moveType 0-3> <filter 0/1> <numThreads> <optional featureSet move/lite/litefull>"),
 };
 
 static map<string,MainFuncEntry> initCommandMap()
@@ -65,6 +65,7 @@ namespace MainFuncs
 	int testGameIterator(int argc, const char* const *argv);
 	int viewMoveFeatures(int argc, const char* const *argv);
 	int testMoveFeatureSpeed(int argc, const char* const *argv);
+	int buildFeatureCache(int argc, const char* const *argv);
 
 	//Goal Pattern Generation--------------------------------------------
 	int genGoalPatterns(int argc, const char* const *argv);
@@ -75,6 +76,7 @@ namespace MainFuncs
 	int runEvalBounds(int argc, const char* const *argv);
 	int runEvalBadGood(int argc, const char* const *argv);
 	int optimizeEval(int argc, const char* const *argv);
+	int evalLazyBounds(int argc, const char* const *argv);
 
 	//Tests--------------------------------------------------------------
 	int runBasicTests(int argc, const char* const *argv);
@@ -92,6 +94,12 @@ namespace MainFuncs
 	int findAndSortGoals(int argc, const char* const *argv);
 	int testGoalLoseInOnePatterns(int argc, const char* const *argv);
 
+	//Benchmarks---------------------------------------------------------
+	int benchThreadScaling(int argc, const char* const *argv);
+	int benchMakeMove(int argc, const char* const *argv);
+	int benchCompactBoard(int argc, const char* const *argv);
+	int benchEvalMoveGen(int argc, const char* const *argv);
+
 }
 
 
@@ -0,0 +1,380 @@
+/*
+ * mainbench.cpp
+ * Author: davidwu
+ */
+#include "pch.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "global.h"
+#include "board.h"
+#include "compactboard.h"
+#include "eval.h"
+#include "boardhistory.h"
+#include "boardmovegen.h"
+#include "timer.h"
+#include "rand.h"
+#include "search.h"
+#include "searchparams.h"
+#include "arimaaio.h"
+#include "command.h"
+#include "main.h"
+
+using namespace std;
+using namespace ArimaaIO;
+
+static const char* BENCH_DEFAULT_GAME =
+		"1g Ra1 Rb1 Rc1 Rd1 Ce1 Rf1 Dg1 Rh1 Da2 Cb2 Rc2 Hd2 He2 Ef2 Mg2 Rh2 \n"
+		"1s ra7 hb7 hc7 ed7 de7 df7 mg7 ch7 ra8 rb8 cc8 rd8 re8 rf8 rg8 rh8 \n2g ";
+
+//Positions to benchmark on, from a board file, or else just the usual opening
+static vector<Board> getBenchPositions(const vector<string>& args, int idx)
+{
+	if((int)args.size() > idx)
+		return readBoardFile(args[idx]);
+
+	GameRecord record = readMoves(string(BENCH_DEFAULT_GAME));
+	BoardHistory hist(record);
+	vector<Board> boards;
+	boards.push_back(hist.turnBoard[hist.maxTurnNumber]);
+	return boards;
+}
+
+int MainFuncs::benchThreadScaling(int argc, const char* const *argv)
+{
+	vector<string> args = Command::parseCommand(argc, argv);
+	if(args.size() < 3 || args.size() > 4)
+		return EXIT_FAILURE;
+
+	int depth = Global::stringToInt(args[1]);
+	int maxThreads = Global::stringToInt(args[2]);
+	if(depth <= 0 || maxThreads <= 0 || maxThreads > SearchParams::MAX_THREADS)
+		return EXIT_FAILURE;
+	vector<Board> boards = getBenchPositions(args,3);
+
+	//1, 2, 4, ... and finally maxThreads itself
+	vector<int> threadCounts;
+	for(int t = 1; t < maxThreads; t *= 2)
+		threadCounts.push_back(t);
+	threadCounts.push_back(maxThreads);
+
+	//Run every thread count in both parallel modes over the same positions. Since each search is to a fixed
+	//depth, the time is the time to reach that depth.
+	const int modes[2] = {SearchParams::PARALLEL_SPLITPOINT, SearchParams::PARALLEL_LAZYSMP};
+	const char* modeNames[2] = {"SplitPoint", "LazySMP"};
+	double baseTime = 0;
+	double baseNps = 0;
+	for(int i = 0; i<(int)threadCounts.size(); i++)
+	{
+		for(int m = 0; m<2; m++)
+		{
+			//With one thread the modes are the same search
+			if(threadCounts[i] == 1 && m > 0)
+				continue;
+
+			SearchParams params;
+			params.setNumThreads(threadCounts[i]);
+			params.setParallelMode(modes[m]);
+			params.setRandomize(false,0,0);
+			Searcher searcher(params);
+
+			SearchStats total;
+			double time = 0;
+			for(int j = 0; j<(int)boards.size(); j++)
+			{
+				BoardHistory hist(boards[j]);
+				searcher.searchID(boards[j],hist,depth,0,false);
+				total += searcher.stats;
+				time += searcher.stats.timeTaken;
+			}
+
+			int64_t nodes = total.mNodes + total.qNodes;
+			double nps = nodes / max(time,1e-9);
+			if(i == 0)
+			{baseTime = time; baseNps = nps;}
+
+			cout << Global::strprintf("%-10s Threads %3d Time %8.3f Nodes %12lld NPS %10.0f Speedup %6.2f NPSScaling %6.2f PubWorkAvgDepth %5.2f",
+					modeNames[m], threadCounts[i], time, (long long)nodes, nps, baseTime / max(time,1e-9), nps / max(baseNps,1e-9),
+					total.publicWorkRequests == 0 ? 0.0 : (double)total.publicWorkDepthSum / total.publicWorkRequests) << endl;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+//Throughput of copying the board and making a move on the copy, versus making and then undoing the move in place
+int MainFuncs::benchMakeMove(int argc, const char* const *argv)
+{
+	vector<string> args = Command::parseCommand(argc, argv);
+	if(args.size() < 2 || args.size() > 3)
+		return EXIT_FAILURE;
+
+	int reps = Global::stringToInt(args[1]);
+	if(reps <= 0)
+		return EXIT_FAILURE;
+	vector<Board> boards = getBenchPositions(args,2);
+
+	//Every step and push/pull from every position
+	vector<Board> starts;
+	vector<move_t> moves;
+	move_t mv[512];
+	for(int i = 0; i<(int)boards.size(); i++)
+	{
+		const Board& b = boards[i];
+		int num = BoardMoveGen::genSteps(b,b.player,mv);
+		if(b.step < 3)
+			num += BoardMoveGen::genPushPulls(b,b.player,mv+num);
+		for(int j = 0; j<num; j++)
+		{
+			starts.push_back(b);
+			moves.push_back(mv[j]);
+		}
+	}
+	int n = moves.size();
+	if(n == 0)
+		return EXIT_FAILURE;
+
+	//Sum a hash so that the compiler can't skip any of the work
+	ClockTimer timer;
+	hash_t copySum = 0;
+	for(int r = 0; r<reps; r++)
+	{
+		for(int i = 0; i<n; i++)
+		{
+			Board copy = starts[i];
+			copy.makeMove(moves[i]);
+			copySum += copy.sitCurrentHash;
+		}
+	}
+	double copyTime = timer.getSeconds();
+
+	timer.reset();
+	hash_t undoSum = 0;
+	UndoMoveData udata;
+	for(int r = 0; r<reps; r++)
+	{
+		for(int i = 0; i<n; i++)
+		{
+			Board& b = starts[i];
+			b.makeMove(moves[i],udata);
+			undoSum += b.sitCurrentHash;
+			b.undoMove(udata);
+		}
+	}
+	double undoTime = timer.getSeconds();
+
+	if(copySum != undoSum)
+		Global::fatalError("benchMakeMove: copy-make and make-unmake disagree");
+
+	double total = (double)n * reps;
+	cout << Global::strprintf("Moves %lld SizeofBoard %d SizeofUndo %d", (long long)total, (int)sizeof(Board), (int)sizeof(UndoMoveData)) << endl;
+	cout << Global::strprintf("CopyMake   %8.3fs %12.0f moves/s", copyTime, total / max(copyTime,1e-9)) << endl;
+	cout << Global::strprintf("MakeUnmake %8.3fs %12.0f moves/s", undoTime, total / max(undoTime,1e-9)) << endl;
+
+	return EXIT_SUCCESS;
+}
+
+//Copy cost, makeMove throughput and history memory of CompactBoard versus Board. The history part plays a random
+//game of the given number of turns from each position and compares storing every turn's board in each form.
+int MainFuncs::benchCompactBoard(int argc, const char* const *argv)
+{
+	vector<string> args = Command::parseCommand(argc, argv);
+	if(args.size() < 3 || args.size() > 4)
+		return EXIT_FAILURE;
+
+	int reps = Global::stringToInt(args[1]);
+	int turns = Global::stringToInt(args[2]);
+	if(reps <= 0 || turns <= 0)
+		return EXIT_FAILURE;
+	vector<Board> boards = getBenchPositions(args,3);
+
+	//Every step and push/pull from every position
+	vector<Board> starts;
+	vector<CompactBoard> compactStarts;
+	vector<move_t> moves;
+	move_t mv[512];
+	for(int i = 0; i<(int)boards.size(); i++)
+	{
+		const Board& b = boards[i];
+		int num = BoardMoveGen::genSteps(b,b.player,mv);
+		if(b.step < 3)
+			num += BoardMoveGen::genPushPulls(b,b.player,mv+num);
+		for(int j = 0; j<num; j++)
+		{
+			starts.push_back(b);
+			compactStarts.push_back(CompactBoard(b));
+			moves.push_back(mv[j]);
+		}
+	}
+	int n = moves.size();
+	if(n == 0)
+		return EXIT_FAILURE;
+
+	cout << Global::strprintf("SizeofBoard %d SizeofCompactBoard %d", (int)sizeof(Board), (int)sizeof(CompactBoard)) << endl;
+
+	//Copies alone, into a buffer so that the compiler has to do them
+	vector<Board> copies(n);
+	vector<CompactBoard> compactCopies(n);
+	ClockTimer timer;
+	for(int r = 0; r<reps; r++)
+		for(int i = 0; i<n; i++)
+			copies[(i+r)%n] = starts[i];
+	double copyTime = timer.getSeconds();
+
+	timer.reset();
+	for(int r = 0; r<reps; r++)
+		for(int i = 0; i<n; i++)
+			compactCopies[(i+r)%n] = compactStarts[i];
+	double compactCopyTime = timer.getSeconds();
+
+	//Copy and make, summing a hash to check that both agree
+	timer.reset();
+	hash_t sum = 0;
+	for(int r = 0; r<reps; r++)
+	{
+		for(int i = 0; i<n; i++)
+		{
+			Board copy = starts[i];
+			copy.makeMove(moves[i]);
+			sum += copy.sitCurrentHash;
+		}
+	}
+	double makeTime = timer.getSeconds();
+
+	timer.reset();
+	hash_t compactSum = 0;
+	for(int r = 0; r<reps; r++)
+	{
+		for(int i = 0; i<n; i++)
+		{
+			CompactBoard copy = compactStarts[i];
+			copy.makeMove(moves[i]);
+			compactSum += copy.getSitCurrentHash();
+		}
+	}
+	double compactMakeTime = timer.getSeconds();
+
+	if(sum != compactSum)
+		Global::fatalError("benchCompactBoard: Board and CompactBoard makeMove disagree");
+
+	//Conversion back to a full board
+	timer.reset();
+	for(int r = 0; r<reps; r++)
+		for(int i = 0; i<n; i++)
+			compactStarts[i].toBoard(copies[i]);
+	double toBoardTime = timer.getSeconds();
+
+	double total = (double)n * reps;
+	cout << Global::strprintf("Copy          Board %8.3fs %12.0f/s CompactBoard %8.3fs %12.0f/s",
+			copyTime, total / max(copyTime,1e-9), compactCopyTime, total / max(compactCopyTime,1e-9)) << endl;
+	cout << Global::strprintf("CopyMakeMove  Board %8.3fs %12.0f/s CompactBoard %8.3fs %12.0f/s",
+			makeTime, total / max(makeTime,1e-9), compactMakeTime, total / max(compactMakeTime,1e-9)) << endl;
+	cout << Global::strprintf("ToBoard                                 CompactBoard %8.3fs %12.0f/s",
+			toBoardTime, total / max(toBoardTime,1e-9)) << endl;
+
+	//History memory on long random games, with any legal single steps each turn
+	Rand rand(Global::getHash("benchCompactBoard"));
+	int64_t boardAllocBytes = 0;
+	int64_t boardBytes = 0;
+	int64_t compactBytes = 0;
+	int64_t numTurns = 0;
+	for(int i = 0; i<(int)boards.size(); i++)
+	{
+		Board b = boards[i];
+		vector<move_t> gameMoves;
+		for(int t = 0; t<turns; t++)
+		{
+			move_t move = ERRORMOVE;
+			int ns = 0;
+			do
+			{
+				int num = BoardMoveGen::genSteps(b,b.player,mv);
+				if(num == 0)
+					break;
+				move_t m = mv[rand.nextUInt(num)];
+				move = Board::concatMoves(move,m,ns);
+				ns++;
+				b.makeMove(m);
+			} while(b.step != 0);
+
+			if(ns == 0)
+				break;
+			if(b.step != 0)
+			{
+				move = Board::concatMoves(move,PASSMOVE,ns);
+				b.makeMove(PASSMOVE);
+			}
+			gameMoves.push_back(move);
+		}
+
+		BoardHistory hist(boards[i],gameMoves);
+		vector<CompactBoard> compactHist;
+		for(int t = hist.minTurnNumber; t <= hist.maxTurnNumber; t++)
+			compactHist.push_back(CompactBoard(hist.turnBoard[t]));
+
+		//BoardHistory indexes turnBoard from turn 0 and grows it ahead of time, so it allocates more than it uses
+		boardAllocBytes += (int64_t)hist.turnBoard.capacity() * sizeof(Board);
+		boardBytes += (int64_t)compactHist.size() * sizeof(Board);
+		compactBytes += (int64_t)compactHist.size() * sizeof(CompactBoard);
+		numTurns += hist.maxTurnNumber - hist.minTurnNumber;
+	}
+	cout << Global::strprintf("History turns %lld BoardAllocated %lld bytes Board %lld bytes CompactBoard %lld bytes",
+			(long long)numTurns, (long long)boardAllocBytes, (long long)boardBytes, (long long)compactBytes) << endl;
+
+	return EXIT_SUCCESS;
+}
+
+//Time move generation and evaluation over the positions, the main users of Bitmap::countBits and nextBit.
+//Compare builds with and without BITMAP_NO_INTRINSICS to see what the hardware instructions gain.
+int MainFuncs::benchEvalMoveGen(int argc, const char* const *argv)
+{
+	vector<string> args = Command::parseCommand(argc, argv);
+	if(args.size() < 2 || args.size() > 3)
+		return EXIT_FAILURE;
+
+	int reps = Global::stringToInt(args[1]);
+	if(reps <= 0)
+		return EXIT_FAILURE;
+	vector<Board> boards = getBenchPositions(args,2);
+	int n = boards.size();
+
+	cout << "Bitmap " << Bitmap::getIntrinsicsDesc() << endl;
+
+	//Sum the results so that the compiler can't skip any of the work
+	move_t mv[512];
+	ClockTimer timer;
+	int64_t numMoves = 0;
+	for(int r = 0; r<reps; r++)
+	{
+		for(int i = 0; i<n; i++)
+		{
+			const Board& b = boards[i];
+			for(pla_t pla = 0; pla <= 1; pla++)
+			{
+				numMoves += BoardMoveGen::genSteps(b,pla,mv);
+				numMoves += BoardMoveGen::genPushPulls(b,pla,mv);
+			}
+		}
+	}
+	double moveGenTime = timer.getSeconds();
+
+	timer.reset();
+	int64_t evalSum = 0;
+	for(int r = 0; r<reps; r++)
+	{
+		for(int i = 0; i<n; i++)
+		{
+			Board copy = boards[i];
+			evalSum += Eval::evaluate(copy,Eval::LOSE-1,Eval::WIN+1,false);
+		}
+	}
+	double evalTime = timer.getSeconds();
+
+	double total = (double)n * reps;
+	cout << Global::strprintf("MoveGen %8.3fs %12.0f positions/s (%lld moves)", moveGenTime, total / max(moveGenTime,1e-9), (long long)numMoves) << endl;
+	cout << Global::strprintf("Eval    %8.3fs %12.0f positions/s (sum %lld)", evalTime, total / max(evalTime,1e-9), (long long)evalSum) << endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+/*
+ * maineval.cpp
+ * Author: davidwu
+ */
+#include "pch.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "global.h"
+#include "board.h"
+#include "boardmovegen.h"
+#include "eval.h"
+#include "evalparams.h"
+#include "arimaaio.h"
+#include "command.h"
+#include "main.h"
+
+using namespace std;
+using namespace ArimaaIO;
+
+//Measure how far the expensive terms of evaluateWithParams move the score away from the cheap first stage,
+//on every position in the file and every position one step or push/pull away from them, since qsearch
+//leaves are usually partway through a turn. Suggests Eval::LAZY_MARGIN_ABOVE and LAZY_MARGIN_BELOW.
+int MainFuncs::evalLazyBounds(int argc, const char* const *argv)
+{
+	vector<string> args = Command::parseCommand(argc, argv);
+	if(args.size() < 2 || args.size() > 3)
+		return EXIT_FAILURE;
+
+	vector<Board> boards = readBoardFile(args[1]);
+	EvalParams params;
+	if(args.size() > 2)
+		params = EvalParams::inputFromFile(args[2]);
+
+	vector<eval_t> diffs;
+	move_t mv[512];
+	for(int i = 0; i<(int)boards.size(); i++)
+	{
+		Board b = boards[i];
+		pla_t mainPla = b.player;
+		eval_t cheapScore;
+		eval_t fullScore;
+		Eval::getStagedEvalWithParams(b,mainPla,params,cheapScore,fullScore);
+		diffs.push_back(fullScore - cheapScore);
+
+		if(b.step >= 3)
+			continue;
+		int num = BoardMoveGen::genSteps(b,b.player,mv);
+		num += BoardMoveGen::genPushPulls(b,b.player,mv+num);
+		for(int m = 0; m<num; m++)
+		{
+			Board copy = b;
+			copy.makeMove(mv[m]);
+			Eval::getStagedEvalWithParams(copy,mainPla,params,cheapScore,fullScore);
+			diffs.push_back(fullScore - cheapScore);
+		}
+	}
+
+	if(diffs.size() == 0)
+		return EXIT_FAILURE;
+
+	std::sort(diffs.begin(),diffs.end());
+	int n = diffs.size();
+	const double props[9] = {0.0, 0.001, 0.01, 0.1, 0.5, 0.9, 0.99, 0.999, 1.0};
+	cout << "Positions " << n << endl;
+	cout << "Full - cheap eval percentiles:" << endl;
+	for(int i = 0; i<9; i++)
+	{
+		int idx = min((int)(props[i] * (n-1) + 0.5), n-1);
+		cout << Global::strprintf("%7.1f%% %7d", props[i] * 100, diffs[idx]) << endl;
+	}
+	cout << "Suggested LAZY_MARGIN_ABOVE " << diffs[min((int)(0.999 * (n-1) + 0.5), n-1)] << endl;
+	cout << "Suggested LAZY_MARGIN_BELOW " << -diffs[(int)(0.001 * (n-1) + 0.5)] << endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/*
+ * mainlearn.cpp
+ * Author: davidwu
+ */
+#include "pch.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "global.h"
+#include "gameiterator.h"
+#include "featuremove.h"
+#include "featurecache.h"
+#include "command.h"
+#include "main.h"
+
+using namespace std;
+
+static bool getFeatureSetByName(const string& name, ArimaaFeatureSet& afset)
+{
+	if(name == "move")
+		afset = MoveFeature::getArimaaFeatureSet();
+	else if(name == "lite")
+		afset = MoveFeatureLite::getArimaaFeatureSet();
+	else if(name == "litefull")
+		afset = MoveFeatureLite::getArimaaFeatureSetFullMove();
+	else
+		return false;
+	return true;
+}
+
+//Build the feature cache for a games file, or do nothing if it is already up to date with the games file,
+//the feature set, the move type and filtering, and the GameIterator keep proportions
+int MainFuncs::buildFeatureCache(int argc, const char* const *argv)
+{
+	vector<string> args = Command::parseCommand(argc, argv);
+	if(args.size() < 6 || args.size() > 7)
+		return EXIT_FAILURE;
+
+	string gamesFile = args[1];
+	string cacheFile = args[2];
+	int moveType = Global::stringToInt(args[3]);
+	bool doFiltering = Global::stringToInt(args[4]) != 0;
+	int numThreads = Global::stringToInt(args[5]);
+	if(moveType < GameIterator::STEP_MOVES || moveType > GameIterator::FULL_MOVES || numThreads <= 0)
+		return EXIT_FAILURE;
+
+	ArimaaFeatureSet afset;
+	if(!getFeatureSetByName(args.size() > 6 ? args[6] : string("move"),afset))
+		return EXIT_FAILURE;
+
+	if(!FeatureCache::refresh(afset,gamesFile,moveType,doFiltering,numThreads,cacheFile))
+		cout << "FeatureCache: " << cacheFile << " is up to date" << endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/*
+ * mappedfile.cpp
+ * Author: davidwu
+ */
+#include "pch.h"
+
+#ifdef _WIN32
+ #define _IS_WINDOWS
+#elif _WIN64
+ #define _IS_WINDOWS
+#elif __unix
+ #define _IS_UNIX
+#else
+ #define _IS_UNIX
+#endif
+
+#ifdef _IS_WINDOWS
+  #include <windows.h>
+#endif
+#ifdef _IS_UNIX
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+#include <fstream>
+#include <limits>
+#include "global.h"
+#include "mappedfile.h"
+
+using namespace std;
+
+MappedFile::MappedFile()
+:fileData(NULL),fileSize(0),isOpened(false),isMapped(false),buffer(),handle(NULL),mapHandle(NULL)
+{}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::fitsInMemory(uint64_t size)
+{
+	return size <= (uint64_t)numeric_limits<size_t>::max();
+}
+
+//Fallback when mapping is disabled or fails
+static void readWholeFile(const string& file, vector<char>& buffer)
+{
+	ifstream in(file.c_str(), ios::in | ios::binary);
+	if(in.fail())
+		Global::fatalError("MappedFile: could not open file: " + file);
+	in.seekg(0,ios::end);
+	uint64_t size = in.tellg();
+	in.seekg(0,ios::beg);
+	if(!MappedFile::fitsInMemory(size))
+		Global::fatalError("MappedFile: file is too large for the address space: " + file);
+	buffer.resize(size);
+	if(size > 0)
+		in.read(buffer.data(),size);
+	if(in.fail())
+		Global::fatalError("MappedFile: could not read file: " + file);
+}
+
+//WINDOWS IMPLMENTATIION-------------------------------------------------------------
+
+#ifdef _IS_WINDOWS
+
+void MappedFile::open(const string& file, bool allowMapping)
+{
+	close();
+	isOpened = true;
+	if(allowMapping)
+	{
+		HANDLE h = CreateFileA(file.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+		if(h == INVALID_HANDLE_VALUE)
+			Global::fatalError("MappedFile: could not open file: " + file);
+		LARGE_INTEGER size;
+		if(!GetFileSizeEx(h,&size))
+			Global::fatalError("MappedFile: could not get size of file: " + file);
+		fileSize = size.QuadPart;
+
+		//Empty files can't be mapped, but there's nothing to read either
+		if(fileSize == 0)
+		{
+			CloseHandle(h);
+			fileData = buffer.data();
+			return;
+		}
+
+		HANDLE m = CreateFileMappingA(h,NULL,PAGE_READONLY,0,0,NULL);
+		void* view = (m == NULL || !fitsInMemory(fileSize)) ? NULL : MapViewOfFile(m,FILE_MAP_READ,0,0,0);
+		if(view != NULL)
+		{
+			handle = h;
+			mapHandle = m;
+			fileData = (const char*)view;
+			isMapped = true;
+			return;
+		}
+		if(m != NULL)
+			CloseHandle(m);
+		CloseHandle(h);
+	}
+
+	readWholeFile(file,buffer);
+	fileData = buffer.data();
+	fileSize = buffer.size();
+}
+
+void MappedFile::close()
+{
+	if(isMapped)
+	{
+		UnmapViewOfFile(fileData);
+		CloseHandle((HANDLE)mapHandle);
+		CloseHandle((HANDLE)handle);
+	}
+	fileData = NULL;
+	fileSize = 0;
+	isOpened = false;
+	isMapped = false;
+	handle = NULL;
+	mapHandle = NULL;
+	vector<char>().swap(buffer);
+}
+
+#endif
+
+//UNIX IMPLEMENTATION------------------------------------------------------------------
+
+#ifdef _IS_UNIX
+
+void MappedFile::open(const string& file, bool allowMapping)
+{
+	close();
+	isOpened = true;
+	if(allowMapping)
+	{
+		int fd = ::open(file.c_str(),O_RDONLY);
+		if(fd < 0)
+			Global::fatalError("MappedFile: could not open file: " + file);
+		struct stat st;
+		if(fstat(fd,&st) != 0)
+			Global::fatalError("MappedFile: could not get size of file: " + file);
+		fileSize = st.st_size;
+
+		//Empty files can't be mapped, but there's nothing to read either
+		if(fileSize == 0)
+		{
+			::close(fd);
+			fileData = buffer.data();
+			return;
+		}
+
+		//mmap takes a size_t length, so a file too large for it would be silently truncated
+		void* view = fitsInMemory(fileSize) ? mmap(NULL,(size_t)fileSize,PROT_READ,MAP_PRIVATE,fd,0) : MAP_FAILED;
+		//The mapping stays valid after the descriptor is closed
+		::close(fd);
+		if(view != MAP_FAILED)
+		{
+			fileData = (const char*)view;
+			isMapped = true;
+			return;
+		}
+	}
+
+	readWholeFile(file,buffer);
+	fileData = buffer.data();
+	fileSize = buffer.size();
+}
+
+void MappedFile::close()
+{
+	if(isMapped)
+		munmap((void*)fileData,(size_t)fileSize);
+	fileData = NULL;
+	fileSize = 0;
+	isOpened = false;
+	isMapped = false;
+	handle = NULL;
+	mapHandle = NULL;
+	vector<char>().swap(buffer);
+}
+
+#endif
@@ -0,0 +1,50 @@
+
+/*
+ * mappedfile.h
+ * Author: davidwu
+ *
+ * A read-only view of a whole file, memory-mapped where the OS supports it, else read into memory.
+ * Not copyable, since it owns the mapping.
+ */
+
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class MappedFile
+{
+	const char* fileData;
+	uint64_t fileSize;
+	bool isOpened;
+	bool isMapped;
+	vector<char> buffer; //Holds the contents when not mapped
+
+	void* handle;        //OS specific handles for the mapping
+	void* mapHandle;
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	public:
+	MappedFile();
+	~MappedFile();
+
+	//Open and map the given file, fatal error if it cannot be opened. If allowMapping is false, always read it instead.
+	void open(const string& file, bool allowMapping = true);
+	void close();
+
+	inline bool isOpen() const {return isOpened;}
+	inline const char* data() const {return fileData;}
+	inline uint64_t size() const {return fileSize;}
+	inline bool mapped() const {return isMapped;}
+
+	//Can a file of this size be addressed in memory at all? If not, open is a fatal error and it must be streamed.
+	static bool fitsInMemory(uint64_t size);
+};
+
+#endif /* MAPPEDFILE_H_ */
@@ -11,6 +11,7 @@
 #include <sstream>
 #include <ctime>
 #include "global.h"
+#include "rand.h"
 #include "timer.h"
 #include "bitmap.h"
 #include "board.h"
@@ -34,16 +35,25 @@ using namespace ArimaaIO;
 
 Searcher::Searcher()
 {
-	init();
+	lazyHelperIndex = 0;
+	init(NULL,NULL);
 }
 
 Searcher::Searcher(SearchParams p)
 {
 	params = p;
-	init();
+	lazyHelperIndex = 0;
+	init(NULL,NULL);
 }
 
-void Searcher::init()
+Searcher::Searcher(const SearchParams& p, SearchHashTable* sharedHash, EvalCache* sharedEvalCache, int helperIndex)
+{
+	params = p;
+	lazyHelperIndex = helperIndex;
+	init(sharedHash,sharedEvalCache);
+}
+
+void Searcher::init(SearchHashTable* sharedHash, EvalCache* sharedEvalCache)
 {
 	doOutput = false;
 	mainPla = NPLA;
@@ -52,24 +62,41 @@ void Searcher::init()
 	clockDesiredTime = 0;
 	interrupted = false;
 	cannotInterrupt = false;
+	searching = false;
 
 	idpv = new move_t[SearchParams::PV_ARRAY_SIZE];
 	idpvLen = 0;
 
-	mainHash = new SearchHashTable(params.mainHashExp);
+	ownsMainHash = (sharedHash == NULL);
+	mainHash = ownsMainHash ? new SearchHashTable(params.mainHashExp) : sharedHash;
+	mainHashEvalFingerprint = 0;
+	mainHashPla = NPLA;
+	if(!ownsMainHash)
+		evalCache = sharedEvalCache;
+	else
+		evalCache = SearchParams::EVAL_CACHE_ENABLE ? new EvalCache(params.evalCacheExp) : NULL;
+	evalCacheSalt = 0;
 
 	fullMv = NULL;
 	fullHm = NULL;
 	fullMvCapacity = 0;
 
 	searchTree = NULL;
+	lazyHelperStopped = false;
 }
 
 Searcher::~Searcher()
 {
+	for(int i = 0; i<(int)lazyHelpers.size(); i++)
+		delete lazyHelpers[i];
+
 	delete fullmoveHash;
 	delete[] idpv;
-	delete mainHash;
+	if(ownsMainHash)
+	{
+		delete mainHash;
+		delete evalCache;
+	}
 
 	for(int i = 0; i<(int)historyTable.size(); i++)
 		delete[] historyTable[i];
@@ -216,6 +243,20 @@ void Searcher::interruptExternal()
   clockDesiredTime = 0;
 }
 
+void Searcher::setTimeFromNow(double hardMinSeconds, double seconds, double hardMaxSeconds)
+{
+  double used = clockTimer.getSeconds();
+  clockOptimisticTime = used + seconds;
+  clockHardMinTime = used + hardMinSeconds;
+  clockHardMaxTime = used + hardMaxSeconds;
+  clockDesiredTime = used + seconds;
+}
+
+bool Searcher::isSearching()
+{
+  return searching;
+}
+
 //Helpers-----------------------------------------------------
 
 struct RatedMove
@@ -228,6 +269,23 @@ struct RatedMove
 	{return val > other.val;}
 };
 
+//Swap some adjacent pairs of moves, keeping the ordering roughly intact
+static void perturbRootOrder(uint64_t seed, vector<move_t>& mv)
+{
+	Rand rand(seed);
+	int num = mv.size();
+	for(int i = 0; i<num-1; i++)
+	{
+		if(rand.nextUInt(4) == 0)
+		{
+			move_t mtemp = mv[i];
+			mv[i] = mv[i+1];
+			mv[i+1] = mtemp;
+			i++;
+		}
+	}
+}
+
 //Iterative deepening search-------------------------------------------------------------
 
 void Searcher::searchID(const Board& b, const BoardHistory& hist, int depth, double seconds)
@@ -272,11 +330,34 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int depth,
 	clockHardMinTime = hardMinSeconds;
 	clockHardMaxTime = hardMaxSeconds;
 	interrupted = false;
+	searching = true;
 
 	SearchUtils::endPV(idpv,idpvLen);
 
-	mainHash->clear();
+	//Keep the hashtable from previous searches around, consecutive turns of a game share a lot of the tree
+	//But its bounds are only valid for the same eval, which depends on the eval params and on mainPla
+	//Lazy SMP helpers share the table with the main searcher, which has already aged or cleared it for this search
+	if(ownsMainHash)
+	{
+		uint64_t evalFingerprint = params.useEvalParams ? params.evalParams.getFingerprint() : 0;
+		if(evalFingerprint != mainHashEvalFingerprint || mainPla != mainHashPla)
+		{
+			mainHash->clear();
+			mainHashEvalFingerprint = evalFingerprint;
+			mainHashPla = mainPla;
+		}
+		else
+			mainHash->newSearch();
+	}
 	SearchUtils::ensureHistory(historyTable,historyMax,max(depth,0));
+
+	//Cached evals stay valid across searches as long as the eval they came from is the same
+	//The eval params use mainPla, so the player matters too. Not by xoring HASHPLA, which would cancel out against
+	//the HASHPLA for the side to move already in the situation hash!
+	if(params.useEvalParams)
+		evalCacheSalt = params.evalParams.getFingerprint() + (hash_t)(mainPla+1) * 0x9E3779B97F4A7C15ULL;
+	else
+		evalCacheSalt = 0;
 	SearchUtils::clearHistory(historyTable,historyMax);
 
 	//Check if the game is over. If so, we're done!
@@ -288,14 +369,34 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int depth,
 		stats.depthReached = 0;
 		stats.finalEval = gameEndVal;
 		stats.pvString = string();
+		searching = false;
 		return;
 	}
 
-	//Initialize search tree, which also spawns off threads ready to help when the search starts
-	DEBUGASSERT(searchTree == NULL);
+	//Initialize search tree. It and its helper threads are kept from search to search, parked between them,
+	//and only rebuilt if the number of threads changes or we need to search deeper than it is sized for
+	//In lazy SMP mode, the tree is searched by this thread alone and the other threads run helper searchers
+	bool lazySMP = params.parallelMode == SearchParams::PARALLEL_LAZYSMP && params.numThreads > 1;
+	int numTreeThreads = lazySMP ? 1 : params.numThreads;
 	int maxMSearchDepth =  max(depth,0)+SearchParams::MAX_MSEARCH_DEPTH_OVER_NOMINAL;
 	int maxCDepth = maxMSearchDepth + SearchParams::QMAX_CDEPTH;
-	searchTree = new SearchTree(this, params.numThreads, maxMSearchDepth, maxCDepth, b, mainBoardHistory);
+	if(searchTree != NULL && !searchTree->canSearch(numTreeThreads, maxMSearchDepth))
+	{
+		delete searchTree;
+		searchTree = NULL;
+	}
+	if(searchTree == NULL)
+	{
+		searchTree = new SearchTree(this, numTreeThreads, maxMSearchDepth, maxCDepth);
+		searchTree->startThreads();
+	}
+	searchTree->initSearch(b, mainBoardHistory);
+
+	if(lazySMP && depth > 0)
+	{
+		ensureLazyHelpers(params.numThreads-1);
+		startLazyHelpers(b, mainBoardHistory, depth);
+	}
 
 	eval_t alpha = Eval::LOSE-1;
   eval_t beta = Eval::WIN-1;
@@ -314,7 +415,22 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int depth,
 		vector<move_t> mvVec;
 		int startDepth = min(depth,nsInTurn);
 		bool doWLPrune = params.enableGoalTree;
-		SearchUtils::genFullMoves(b, mainBoardHistory, mvVec, startDepth, doWLPrune, fullmoveHash);
+
+		//Root generation and scoring run on the parked tree threads, but no more than there are cores for
+		int numRootThreads = numTreeThreads;
+		int numCores = std::thread::hardware_concurrency();
+		if(numCores > 0 && numRootThreads > numCores)
+			numRootThreads = numCores;
+		SearchTree* tree = searchTree;
+		auto runOnThreads = [tree](int numThreads, const std::function<void(int)>& job) {
+			tree->runOnThreads(numThreads,job);
+		};
+
+		move_t rootMv[256];
+		if(numRootThreads > 1 && startDepth >= 4 && SearchUtils::genRegularMoves(b,rootMv) >= SearchParams::ROOT_GEN_MIN_ROOT_MOVES)
+			SearchUtils::genFullMovesParallel(b, mainBoardHistory, mvVec, startDepth, doWLPrune, numRootThreads, runOnThreads, fullmoveHash);
+		else
+			SearchUtils::genFullMoves(b, mainBoardHistory, mvVec, startDepth, doWLPrune, fullmoveHash);
 
 		if(params.randomize)
 			SearchUtils::shuffle(params.randSeed,mvVec);
@@ -329,13 +445,22 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int depth,
 			int size = mvVec.size();
 			RatedMove* rmoves = new RatedMove[size];
 
-			for(int m = 0; m < size; m++)
-			{
-				move_t move = mvVec[m];
-				rmoves[m].move = move;
-				rmoves[m].val = params.rootMoveFeatureSet.getFeatureSum(
-						bCopy,moveFeatureData,mainPla,move,mainBoardHistory,params.rootMoveFeatureWeights);
-			}
+			//Each move is scored independently, so split them into contiguous blocks across the threads
+			int numBlocks = min(numRootThreads, size / SearchParams::ROOT_SCORE_MIN_MOVES_PER_THREAD);
+			if(numBlocks < 1)
+				numBlocks = 1;
+			runOnThreads(numBlocks,[this,&b,&mvVec,rmoves,&moveFeatureData,size,numBlocks](int t) {
+				int start = size*t/numBlocks;
+				int end = size*(t+1)/numBlocks;
+				FeatureBuffer featureBuffer;
+				for(int m = start; m < end; m++)
+				{
+					move_t move = mvVec[m];
+					rmoves[m].move = move;
+					rmoves[m].val = params.rootMoveFeatureSet.getFeatureSum(
+							b,moveFeatureData,mainPla,move,mainBoardHistory,params.rootMoveFeatureWeights,featureBuffer);
+				}
+			});
 
 			std::stable_sort(rmoves,rmoves+size);
 
@@ -345,6 +470,10 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int depth,
 			delete[] rmoves;
 		}
 
+		//Lazy SMP helpers each jitter the root ordering a little, so that they tend to get to different moves first
+		if(lazyHelperIndex > 0)
+			perturbRootOrder(params.randSeed + (uint64_t)lazyHelperIndex * 0x9E3779B97F4A7C15ULL, mvVec);
+
 		//Convert to arrays
 		int numMoves = mvVec.size();
 		SearchUtils::ensureMoveArray(fullMv,fullHm,fullMvCapacity,numMoves);
@@ -374,8 +503,9 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int depth,
 			depth = startDepth;
 
 		//Iteratively search deeper
+		//Odd lazy SMP helpers skip a depth so that helpers are spread across two iterations at once
 		cannotInterrupt = false;
-		for(int d = startDepth+1; d <= depth; d++)
+		for(int d = startDepth+1+(lazyHelperIndex % 2); d <= depth; d++)
 		{
 			SearchUtils::decayHistory(historyTable,historyMax);
 
@@ -414,17 +544,69 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int depth,
 		}
 	}
 
-	//The whole search is done. The search tree destructor signals and waits for the helper threads to
-	//terminate completely
+	//The whole search is done. The helper threads are all parked again, waiting for the next search
 	DEBUGASSERT(searchTree != NULL);
-	delete searchTree;
-	searchTree = NULL;
+	if(lazySMP && depth > 0)
+	{
+		stopLazyHelpers();
+		for(int i = 0; i<(int)lazyHelpers.size(); i++)
+			stats += lazyHelpers[i]->stats;
+	}
 
 	//Update data
 	stats.timeTaken = clockTimer.getSeconds();
+	searching = false;
 }
 
 
+//LAZY SMP----------------------------------------------------------------------------
+
+void Searcher::ensureLazyHelpers(int numHelpers)
+{
+	DEBUGASSERT(lazyHelperIndex == 0);
+	while((int)lazyHelpers.size() > numHelpers)
+	{
+		delete lazyHelpers.back();
+		lazyHelpers.pop_back();
+	}
+
+	//Helpers search with the same params, including the same random seed so that they agree with the
+	//main searcher about randomized evals stored in the shared hashtable
+	SearchParams helperParams = params;
+	helperParams.numThreads = 1;
+	helperParams.parallelMode = SearchParams::PARALLEL_SPLITPOINT;
+	helperParams.viewOn = false;
+	helperParams.stopEarlyWhenLittleTime = false;
+	for(int i = 0; i<(int)lazyHelpers.size(); i++)
+		lazyHelpers[i]->params = helperParams;
+	while((int)lazyHelpers.size() < numHelpers)
+		lazyHelpers.push_back(new Searcher(helperParams, mainHash, evalCache, lazyHelpers.size()+1));
+}
+
+void Searcher::startLazyHelpers(const Board& b, const BoardHistory& hist, int depth)
+{
+	DEBUGASSERT(lazyHelperThreads.size() == 0);
+	for(int i = 0; i<(int)lazyHelpers.size(); i++)
+	{
+		Searcher* helper = lazyHelpers[i];
+		helper->lazyHelperStopped = false;
+		lazyHelperThreads.push_back(std::thread([helper,&b,&hist,depth]() {
+			//Unbounded in time, it runs until it hits the depth or the main search stops it
+			helper->searchID(b,hist,depth,0,0,0,false);
+		}));
+	}
+}
+
+void Searcher::stopLazyHelpers()
+{
+	//The flag stays set even if a helper is only now starting its search and its clock
+	for(int i = 0; i<(int)lazyHelpers.size(); i++)
+		lazyHelpers[i]->lazyHelperStopped = true;
+	for(int i = 0; i<(int)lazyHelperThreads.size(); i++)
+		lazyHelperThreads[i].join();
+	lazyHelperThreads.clear();
+}
+
 //FSEARCH-----------------------------------------------------------------------------
 
 //Perform search and stores best eval found in stats.finalEval, behaving appropriately depending on allowance
@@ -963,8 +1145,9 @@ int Searcher::qSearch(SearchThread* curThread, Board& b, int fDepth, int cDepth,
   	if(alpha > 0 && SearchUtils::isTerminalEval(alpha))
   		return alpha;
 
-		int eval = evaluate(curThread,b,alpha,beta,params.viewingEval(b));
-		mainHash->record(b, cDepth, -qDepth, eval, Flags::FLAG_EXACT, ERRORMOVE);
+		flag_t evalFlag;
+		int eval = evaluate(curThread,b,alpha,beta,params.viewingEval(b),evalFlag);
+		mainHash->record(b, cDepth, -qDepth, eval, evalFlag, ERRORMOVE);
 		return eval;
 	}
 
@@ -1374,28 +1557,27 @@ int Searcher::genMSearchMoves(SearchThread* curThread, const Board& b, int cDept
 	{
 		SearchUtils::getHistoryScores(historyTable,historyMax,b,b.player,cDepth,mv,hm,num);
 
-		if(params.treeMoveFeatureSet.fset != NULL)
+		//Use the full feature set near the root, and the lite one if any deeper in the tree
+		const ArimaaFeatureSet* afset = NULL;
+		const vector<double>* weights = NULL;
+		int setId = 0;
+		if(params.treeMoveFeatureSet.fset != NULL &&
+				(params.treeMoveFeatureSetLite.fset == NULL || rDepth4 >= params.treeMoveFullMinDepth * SearchParams::DEPTH_DIV))
+		{afset = &params.treeMoveFeatureSet; weights = &params.treeMoveFeatureWeights; setId = SearchParams::TREE_FEATURE_SET_FULL;}
+		else if(params.treeMoveFeatureSetLite.fset != NULL)
+		{afset = &params.treeMoveFeatureSetLite; weights = &params.treeMoveFeatureWeightsLite; setId = SearchParams::TREE_FEATURE_SET_LITE;}
+
+		if(afset != NULL)
 		{
-			int turnsFromStart = b.turnNumber - curThread->mainBoardTurnNumber;
-			if((int)curThread->featurePosDataHash.size() < turnsFromStart+1)
-			{
-				curThread->featurePosDataHash.resize(turnsFromStart+1);
-				curThread->featurePosData.resize(turnsFromStart+1);
-			}
-
 			const Board& turnBoard = curThread->boardHistory.turnBoard[b.turnNumber];
 			move_t turnMove = curThread->boardHistory.turnMove[b.turnNumber];
-			FeaturePosData& moveFeatureData = curThread->featurePosData[turnsFromStart];
-			if(curThread->featurePosDataHash[turnsFromStart] != turnBoard.sitCurrentHash)
-			{
-				params.treeMoveFeatureSet.getPosData(turnBoard,curThread->boardHistory,turnBoard.player,moveFeatureData);
-				curThread->featurePosDataHash[turnsFromStart] = turnBoard.sitCurrentHash;
-			}
+			const FeaturePosData& moveFeatureData = curThread->featurePosCache.get(*afset,setId,turnBoard,curThread->boardHistory);
 
 			for(int i = 0; i<num; i++)
 			{
-				hm[i] += (int)(SearchParams::MOVEWEIGHTS_SCALE * params.treeMoveFeatureSet.getFeatureSum(
-						turnBoard,moveFeatureData,b.player,Board::concatMoves(turnMove,mv[i],b.step),curThread->boardHistory,params.treeMoveFeatureWeights));
+				hm[i] += (int)(SearchParams::MOVEWEIGHTS_SCALE * afset->getFeatureSum(
+						turnBoard,moveFeatureData,b.player,Board::concatMoves(turnMove,mv[i],b.step),curThread->boardHistory,*weights,
+						curThread->featureBuffer));
 			}
 		}
 		else
@@ -1424,7 +1606,7 @@ void Searcher::tryCheckTime(SearchThread* curThread)
 	  curThread->timeCheckCounter = 0;
 	  double desiredTime = clockDesiredTime;
 	  double usedTime = clockTimer.getSeconds();
-		if(usedTime > desiredTime)
+		if(usedTime > desiredTime || lazyHelperStopped)
 		{
 			interrupted = true;
 			searchTree->timeout(curThread);
@@ -1545,22 +1727,19 @@ move_t Searcher::getMove(move_t* mv, int* hm, int numMoves, int idx)
 
 //HELPERS - EVALUATION----------------------------------------------------------------------
 
-eval_t Searcher::evaluate(SearchThread* curThread, Board& b, eval_t alpha, eval_t beta, bool print)
+eval_t Searcher::evaluate(SearchThread* curThread, Board& b, eval_t alpha, eval_t beta, bool print, flag_t& flag)
 {
 	curThread->stats.evalCalls++;
 
-	eval_t eval;
-	if(params.useEvalParams)
-		eval = Eval::evaluateWithParams(b,mainPla,alpha,beta,params.evalParams,print);
-	else
-		eval = Eval::evaluate(b,alpha,beta,print);
-
+	//Adjustments on top of the raw eval. These are cheap and depend on more than the position, so they are
+	//computed first and kept out of the cache, and the window for the raw eval is shifted by them.
+	eval_t adjust = 0;
 	if(params.avoidEarlyTrade && mainBoard.turnNumber <= SearchParams::EARLY_TRADE_TURN_MAX)
 	{
 		if(b.pieceCounts[mainPla][0] != mainBoard.pieceCounts[mainPla][0])
 		{
-			if(mainPla == b.player) eval -= params.earlyTradePenalty;
-			else eval += params.earlyTradePenalty;
+			if(mainPla == b.player) adjust -= params.earlyTradePenalty;
+			else adjust += params.earlyTradePenalty;
 		}
 	}
 
@@ -1580,11 +1759,35 @@ eval_t Searcher::evaluate(SearchThread* curThread, Board& b, eval_t alpha, eval_
 
 		int randvalues = hash % d2;
 		int randvalues2 = ((hash >> 32) & 0x00000000FFFFFFFFULL) % d;
-		eval += (randvalues % d)-params.randDelta;
-		eval += (randvalues/d)-params.randDelta;
-		eval += randvalues2-params.randDelta;
+		adjust += (randvalues % d)-params.randDelta;
+		adjust += (randvalues/d)-params.randDelta;
+		adjust += randvalues2-params.randDelta;
 	}
 
-	return eval;
+	//The cache holds exact raw evals only. A lazy eval's bound is only good for the window it was computed with.
+	flag = Flags::FLAG_EXACT;
+	eval_t eval;
+	hash_t evalKey = b.sitCurrentHash ^ evalCacheSalt;
+	if(evalCache != NULL && !print && evalCache->lookup(evalKey,eval))
+		curThread->stats.evalCacheHits++;
+	else
+	{
+		if(params.useEvalParams)
+		{
+			bool isExact;
+			eval = Eval::evaluateWithParams(b,mainPla,alpha-adjust,beta-adjust,params.evalParams,print,isExact);
+			if(!isExact)
+			{
+				flag = eval <= alpha-adjust ? Flags::FLAG_ALPHA : Flags::FLAG_BETA;
+				curThread->stats.lazyEvals++;
+			}
+		}
+		else
+			eval = Eval::evaluate(b,alpha-adjust,beta-adjust,print);
+		if(evalCache != NULL && flag == Flags::FLAG_EXACT)
+			evalCache->record(evalKey,eval);
+	}
+
+	return eval + adjust;
 }
 
@@ -67,6 +67,8 @@
 #ifndef SEARCH_H
 #define SEARCH_H
 
+#include <thread>
+#include <atomic>
 #include "timer.h"
 #include "bitmap.h"
 #include "board.h"
@@ -80,6 +82,7 @@
 class QState;
 class SearchHashTable;
 class ExistsHashTable;
+class EvalCache;
 
 struct SplitPoint;
 struct SearchThread;
@@ -140,6 +143,9 @@ class Searcher
 	//Flag this search as uninterruptable - it MUST finish.
 	bool cannotInterrupt;
 
+	//Is a search in progress with its clock started? Can be read by other threads.
+	volatile bool searching;
+
 	//IDPV REPORTING---------------------------------------------------------------
 	move_t* idpv;  //Holds pv found during an interative deepening
 	int idpvLen;   //Length of idpv
@@ -148,6 +154,10 @@ class Searcher
 
 	//HASHTABLE-------------------------------------------------------------------
 	SearchHashTable* mainHash;
+	uint64_t mainHashEvalFingerprint; //Eval fingerprint and mainPla of the last search to use mainHash
+	pla_t mainHashPla;
+	EvalCache* evalCache;  //NULL if disabled
+	hash_t evalCacheSalt;  //Xored into the situation hash to key the eval cache, depends on the eval and mainPla
 
 	//MOVE ORDERING AND PRUNING--------------------------------------------------
 	//History Heuristic
@@ -161,6 +171,14 @@ class Searcher
 	public:
 	SearchTree* searchTree;
 
+	private:
+	//Lazy SMP - helper searchers run alongside the main search, sharing only mainHash
+	vector<Searcher*> lazyHelpers;
+	int lazyHelperIndex; //0 if not a helper, else which helper this is, for perturbing its search
+	bool ownsMainHash;   //False for helpers, which use the mainHash and evalCache of the searcher that created them
+	vector<std::thread> lazyHelperThreads;
+	std::atomic<bool> lazyHelperStopped; //Set to stop a helper. Unlike the clock, searchID doesn't reset it on start.
+
 	//METHODS=================================================================================
 
 	//CONSTRUCTION----------------------------------------------------------------
@@ -170,7 +188,13 @@ class Searcher
 	~Searcher();
 
 	private:
-	void init();
+	Searcher(const SearchParams& params, SearchHashTable* sharedHash, EvalCache* sharedEvalCache, int lazyHelperIndex);
+	void init(SearchHashTable* sharedHash, EvalCache* sharedEvalCache);
+
+	//Run the lazy SMP helpers on the given position until they finish or the main search is done
+	void ensureLazyHelpers(int numHelpers);
+	void startLazyHelpers(const Board& b, const BoardHistory& hist, int depth);
+	void stopLazyHelpers();
 
 	//ACCESSORS----------------------------------------------------------------------------------
 	public:
@@ -206,6 +230,13 @@ class Searcher
   //Try to stop the search. Safe to call from other threads.
   void interruptExternal();
 
+  //Replace the time limits of the search in progress with the given ones, counted from now. Safe to call from
+  //other threads. Use to end an unbounded search, such as pondering, after a normal amount of further thinking.
+  void setTimeFromNow(double hardMinSeconds, double seconds, double hardMaxSeconds);
+
+  //Has searchID started its clock and not yet returned? Safe to call from other threads.
+  bool isSearching();
+
 	//TOP LEVEL SEARCH--------------------------------------------------------------------------------------
 
 	//Perform search and stores best eval found in stats.finalEval, behaving appropriately depending on allowance
@@ -237,7 +268,8 @@ class Searcher
 	//eval_t qSearchPassed(SearchThread* curThread, Board& b, int fDepth, int cDepth, int qDepth4, eval_t alpha, eval_t beta, SearchState qState);
 
 	//Evaluate the actual board position
-	eval_t evaluate(SearchThread* curThread, Board& b, eval_t alpha, eval_t beta, bool print);
+	//Sets flag to FLAG_ALPHA or FLAG_BETA if the eval stopped early and returned only a bound outside [alpha,beta]
+	eval_t evaluate(SearchThread* curThread, Board& b, eval_t alpha, eval_t beta, bool print, flag_t& flag);
 
 	//MOVES------------------------------------------------------------------------------------------------
 
@@ -296,53 +328,124 @@ class Searcher
 
 struct SearchHashEntry
 {
+	//The low bits of the key are implied by the slot the entry lives in, so they are not needed to verify the hash
+	//and instead store the age (generation of search) that the entry was written in.
+	static const uint64_t AGE_MASK = 0xFFULL;
+
 	//Note: for this to work, hash_t should be 64 bits!
 	volatile uint64_t key;
 	volatile uint64_t data;
 
 	SearchHashEntry();
 
-	void record(hash_t hash, int16_t depth4, eval_t eval, flag_t flag, move_t move);
+	void record(hash_t hash, uint8_t age, int16_t depth4, eval_t eval, flag_t flag, move_t move);
 	bool lookup(hash_t hash, int16_t& depth4, eval_t& eval, flag_t& flag, move_t& move);
+
+	//Age of the search that last wrote this entry
+	uint8_t getAge() const;
+
+	//Unverified peeks at the data, for choosing which entry to replace
+	int16_t getDepth4() const;
+	flag_t getFlag() const;
 };
 
 //Thread safe, uses lockless xor scheme to ensure data integrity
+//Persists across searches - entries from earlier searches remain usable, but are tagged with an older age.
+//Entries are grouped into buckets of one cache line. A position may live in any entry of its bucket, and
+//recording replaces the entry from the oldest search, and within a search, the shallowest.
 class SearchHashTable
 {
 	public:
+	static const int BUCKET_EXP = 2;
+	static const int BUCKET_SIZE = 1 << BUCKET_EXP; //Entries per bucket, 4 * 16 bytes = 64 byte cache line
+	static const int MIN_EXP = 10; //Bucket index must cover all of SearchHashEntry::AGE_MASK
+
 	int exponent;
-	hash_t size;
-	hash_t mask;
+	hash_t size;       //Total number of entries
+	hash_t bucketMask; //Mask for the bucket index, there are size/BUCKET_SIZE buckets
 	SearchHashEntry* entries;
+	uint8_t age; //Incremented once per search, stamped into every entry recorded
+
+	private:
+	SearchHashEntry* entriesBuf; //Unaligned allocation backing entries
+
+	public:
 
 	SearchHashTable(int exponent); //Size will be (2 ** sizeExp)
 	~SearchHashTable();
 
 	static int getExp(uint64_t maxMem);
 
+	//Wipe every entry. Expensive, writes the whole table.
 	void clear();
 
+	//Begin a new search. Constant time - entries from previous searches are kept but become older.
+	void newSearch();
+
 	void record(const Board& b, int cDepth, int16_t depth4, eval_t eval, flag_t flag, move_t move);
 	bool lookup(move_t& hashMove, eval_t& hashEval, int16_t& hashDepth4, flag_t& hashFlag, const Board& b, int cDepth);
 
 };
 
+struct EvalCacheEntry
+{
+	//Note: for this to work, hash_t should be 64 bits!
+	volatile uint64_t key;
+	volatile uint64_t data;
+
+	EvalCacheEntry();
+};
+
+//Thread safe, uses lockless xor scheme to ensure data integrity
+//Caches static evaluations, separately from SearchHashTable so that they don't compete with search results.
+//Direct-mapped - a new eval always replaces whatever was in its slot.
+//Callers must fold anything the eval depends on beyond the position (such as eval params) into the key.
+class EvalCache
+{
+	public:
+	int exponent;
+	hash_t size;
+	hash_t mask;
+	EvalCacheEntry* entries;
+
+	EvalCache(int exponent); //Size will be (2 ** sizeExp)
+	~EvalCache();
+
+	void clear();
+
+	bool lookup(hash_t key, eval_t& eval);
+	void record(hash_t key, eval_t eval);
+};
+
 //NOT THREADSAFE!!!
+//Set of situation hashes, open addressed. Each slot is stamped with the generation that wrote it, so clear is
+//constant time. Starts small and doubles when half full, up to the max size, so that the cost of a round of
+//root move generation is proportional to the number of positions recorded rather than the table size.
+//Once at the max size and 3/4 full, further records are dropped, so lookup may then miss things that were recorded.
 class ExistsHashTable
 {
 	public:
-	int exponent;
+	int exponent;    //Current size is 2 ** exponent
+	int maxExponent;
 	hash_t size;
 	hash_t mask;
 	hash_t* hashKeys;
+	uint32_t* stamps;    //Generation in which each slot was written, 0 = never
+	uint32_t generation;
+	hash_t count;        //Number of slots used this generation
 
-	ExistsHashTable(int exponent); //Size will be (2 ** sizeExp)
+	ExistsHashTable(int maxExponent); //Size will be at most (2 ** maxExponent)
 	~ExistsHashTable();
 
 	void clear();
 
 	bool lookup(const Board& b);
 	void record(const Board& b);
+	bool lookup(hash_t hash);
+	void record(hash_t hash);
+
+	private:
+	void resize(int newExponent);
 
 };
 
@@ -60,6 +60,7 @@ void SearchParams::init()
 	randDelta = 0;
 	randSeed = 0;
 	numThreads = 1;
+	parallelMode = PARALLEL_SPLITPOINT;
 
 	disablePartialSearch = false;
 	avoidEarlyTrade = false;
@@ -67,6 +68,7 @@ void SearchParams::init()
 
 	fullMoveHashExp = DEFAULT_FULLMOVE_HASH_EXP;
 	mainHashExp = DEFAULT_MAIN_HASH_EXP;
+	evalCacheExp = DEFAULT_EVAL_CACHE_EXP;
 
 	qEnable = true;
 	enableGoalTree = true;
@@ -80,6 +82,9 @@ void SearchParams::init()
 	stupidPrune = false;
 
 	treeMoveFeatureSet = ArimaaFeatureSet();
+	treeMoveFeatureSetLite = ArimaaFeatureSet();
+	treeMoveFullMinDepth = 0;
+	featurePosCacheExp = DEFAULT_FEATURE_POS_CACHE_EXP;
 
 	useEvalParams = false;
 	evalParams = EvalParams();
@@ -100,11 +105,19 @@ SearchParams::~SearchParams()
 //How many parallel threads to use for the search?
 void SearchParams::setNumThreads(int num)
 {
-	if(num <= 0 || num > 64)
+	if(num <= 0 || num > MAX_THREADS)
 		Global::fatalError("Invalid number of threads: " + Global::intToString(num));
 	numThreads = num;
 }
 
+//Split the tree between threads, or run independent helper searches sharing the hashtable?
+void SearchParams::setParallelMode(int mode)
+{
+	if(mode != PARALLEL_SPLITPOINT && mode != PARALLEL_LAZYSMP)
+		Global::fatalError("Invalid parallel mode: " + Global::intToString(mode));
+	parallelMode = mode;
+}
+
 //Randomization--------------------
 
 //Do we randomize the pv among equally strong moves? And do we add any deltas to the evals?
@@ -170,6 +183,13 @@ void SearchParams::initTreeMoveFeatures(const BradleyTerry& bt)
 	treeMoveFeatureWeights = bt.logGamma;
 }
 
+void SearchParams::initTreeMoveFeaturesLite(const BradleyTerry& bt, int fullMinDepth)
+{
+	treeMoveFeatureSetLite = bt.afset;
+	treeMoveFeatureWeightsLite = bt.logGamma;
+	treeMoveFullMinDepth = fullMinDepth;
+}
+
 //Search options ------------------------------
 
 void SearchParams::setAvoidEarlyTrade(bool avoid, eval_t penalty)
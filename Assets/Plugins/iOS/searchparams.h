@@ -24,7 +24,18 @@ struct SearchParams
 	//CONSTANT==============================================================================
 
 	//MULTITHREADING----------------------------------------------------------
-	static const int MAX_THREADS = 16; //Max number of threads allowed
+	static const int MAX_THREADS = 256; //Max number of threads allowed
+
+	//How extra threads are used
+	static const int PARALLEL_SPLITPOINT = 0; //Threads cooperate on one tree, splitting work at split points
+	static const int PARALLEL_LAZYSMP = 1;    //Extra threads run their own perturbed searches, sharing only the hashtable
+
+	//Root move generation and ordering are also split across the search threads, up to the number of cores.
+	//Generation only for a whole turn from a position with at least this many steps and pushpulls, since smaller
+	//ones take well under a millisecond and expanding by layers costs more total work than the serial DFS.
+	//BT scoring only once there are this many root moves per thread, since it's too cheap per move otherwise.
+	static const int ROOT_GEN_MIN_ROOT_MOVES = 16;
+	static const int ROOT_SCORE_MIN_MOVES_PER_THREAD = 256;
 
 	//MISC--------------------------------------------------------------------
 	static const int EARLY_TRADE_TURN_MAX = 4; //Max turn on which to avoid early trades
@@ -60,6 +71,15 @@ struct SearchParams
 	static const bool HASH_NO_USE_QBM_IN_MAIN = false; //Don't use qsearch best moves in main search
 	static const int DEFAULT_FULLMOVE_HASH_EXP = 21; //Size of hashtable for finding full moves at root is 2**FULLMOVE_HASH_EXP
 
+	//EVAL CACHE----------------------------------------------------------------
+	static const bool EVAL_CACHE_ENABLE = true;
+	static const int DEFAULT_EVAL_CACHE_EXP = 20; //Size of the eval cache is 2**EVAL_CACHE_EXP
+
+	//TREE MOVE FEATURES--------------------------------------------------------
+	static const int DEFAULT_FEATURE_POS_CACHE_EXP = 6; //Size of each thread's cache of FeaturePosDatas is 2**this
+	static const int TREE_FEATURE_SET_FULL = 0;  //Ids for the tree move feature sets, for FeaturePosDataCache
+	static const int TREE_FEATURE_SET_LITE = 1;
+
 
 	//QUIESCENCE-----------------------------------------------------------------
 	static const bool Q_ENABLE = true;
@@ -116,6 +136,7 @@ struct SearchParams
 
 	//MULTITHREADING---------------------------------------------------------------
 	int numThreads; //Number of threads to run simultaneously
+	int parallelMode; //PARALLEL_SPLITPOINT or PARALLEL_LAZYSMP
 
 	//SEARCH PARAMS ---------------------------------------------------------------
 	int defaultMaxDepth;   //Default max depth to search
@@ -134,6 +155,7 @@ struct SearchParams
 	//These two parameters need to be set BEFORE creating the searcher!!
 	int fullMoveHashExp; //Size of hashtable for root move generation is 2**this, defaults to DEFAULT_FULLMOVE_HASH_EXP
 	int mainHashExp; //Size of main hashtable is 2**this, defaults to DEFAULT_MAIN_HASH_EXP
+	int evalCacheExp; //Size of eval cache is 2**this, defaults to DEFAULT_EVAL_CACHE_EXP
 
 	//Enable qsearch?
 	bool qEnable;
@@ -160,6 +182,11 @@ struct SearchParams
 	//TREE INTERNAL MOVE ORDERING AND PRUNING------------------------------------------
 	ArimaaFeatureSet treeMoveFeatureSet;
 	vector<double> treeMoveFeatureWeights;
+	//Cheaper set, such as one from MoveFeatureLite, used instead at nodes with less than treeMoveFullMinDepth steps left
+	ArimaaFeatureSet treeMoveFeatureSetLite;
+	vector<double> treeMoveFeatureWeightsLite;
+	int treeMoveFullMinDepth;
+	int featurePosCacheExp; //Size of each thread's cache of FeaturePosDatas is 2**this
 
 	//EVAL PARAMETERS---------------------------------------------------------------
 	bool useEvalParams;
@@ -192,6 +219,9 @@ struct SearchParams
 	//How many parallel threads to use for the search?
 	void setNumThreads(int num);
 
+	//Split the tree between threads, or run independent helper searches sharing the hashtable?
+	void setParallelMode(int mode);
+
 	//Randomization---------------------------------
 
 	//Do we randomize the pv among equally strong moves?  And do we add any random deltas to the evals?
@@ -219,6 +249,10 @@ struct SearchParams
 	//Add features and weights for tree move ordering
 	void initTreeMoveFeatures(const BradleyTerry& bt);
 
+	//Add cheaper features and weights for tree move ordering at nodes with less than fullMinDepth steps left,
+	//the full ones above being used only with at least that much depth
+	void initTreeMoveFeaturesLite(const BradleyTerry& bt, int fullMinDepth);
+
 	//Search options----------------------------------
 
 	//Set the searcher to avoid early trades
@@ -12,6 +12,8 @@ SearchStats::SearchStats()
 	mNodes = 0;
 	qNodes = 0;
 	evalCalls = 0;
+	evalCacheHits = 0;
+	lazyEvals = 0;
 	mHashCuts = 0;
 	qHashCuts = 0;
 	betaCuts = 0;
@@ -36,6 +38,8 @@ ostream& operator<<(ostream& out, const SearchStats& stats)
 	<< " MNodes " << stats.mNodes
 	<< " QNodes " << stats.qNodes
 	<< " Evals " << stats.evalCalls
+	<< " EvalCacheHitRate " << (stats.evalCalls == 0 ? 0 : (double)stats.evalCacheHits/stats.evalCalls)
+	<< " LazyEvalRate " << (stats.evalCalls == 0 ? 0 : (double)stats.lazyEvals/stats.evalCalls)
 	<< " BetaCut " << stats.betaCuts
 	<< " MHashCut " << stats.mHashCuts
 	<< " QHashCut " << stats.qHashCuts
@@ -55,6 +59,8 @@ SearchStats& SearchStats::operator+=(const SearchStats& rhs)
 	mNodes += rhs.mNodes;
 	qNodes += rhs.qNodes;
 	evalCalls += rhs.evalCalls;
+	evalCacheHits += rhs.evalCacheHits;
+	lazyEvals += rhs.lazyEvals;
 	mHashCuts += rhs.mHashCuts;
 	qHashCuts += rhs.qHashCuts;
 	betaCuts += rhs.betaCuts;
@@ -73,6 +79,8 @@ void SearchStats::overwriteAggregates(const SearchStats& rhs)
 	mNodes = rhs.mNodes;
 	qNodes = rhs.qNodes;
 	evalCalls = rhs.evalCalls;
+	evalCacheHits = rhs.evalCacheHits;
+	lazyEvals = rhs.lazyEvals;
 	mHashCuts = rhs.mHashCuts;
 	qHashCuts = rhs.qHashCuts;
 	betaCuts = rhs.betaCuts;
@@ -19,6 +19,8 @@ struct SearchStats
 	int64_t mNodes;        //Main number of nodes searched (including leaves of main search)
 	int64_t qNodes;        //Quiescence nodes added
 	int64_t evalCalls;     //Number of calls to eval
+	int64_t evalCacheHits; //Number of calls to eval answered by the eval cache
+	int64_t lazyEvals;     //Number of calls to eval that stopped early after the cheap terms
 	int64_t mHashCuts;     //Hash cutoffs made in internal search (not including leaves of main search)
 	int64_t qHashCuts;     //Hash cutoffs made in quiescence (including leaves of main search)
 	int64_t betaCuts;      //Beta cutoffs anywhere
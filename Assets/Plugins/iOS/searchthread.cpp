@@ -17,35 +17,27 @@ using namespace ArimaaIO;
 
 //SEARCHTREE---------------------------------------------------------------------------
 
-SplitPointBuffer::SplitPointBuffer(Searcher* searcher, int maxfd)
+SplitPointBuffer::SplitPointBuffer(Searcher* s, int maxfd)
 {
 	DEBUGASSERT(maxfd >= 0);
+	searcher = s;
 	maxFDepth = maxfd;
-	spts = new SplitPoint[(maxfd+1)*2];
+	spts = new SplitPoint*[(maxfd+1)*2];
 	isUsed = new bool[(maxfd+1)*2];
 	isFirst = new bool[(maxfd+1)*2];
 
-	for(int depth = 0; depth <= maxfd; depth++)
+	for(int idx = 0; idx < (maxfd+1)*2; idx++)
 	{
-		spts[2*depth].searcher = searcher;
-		spts[2*depth+1].searcher = searcher;
-		spts[2*depth].fDepth = depth;
-		spts[2*depth+1].fDepth = depth;
-		spts[2*depth].buffer = this;
-		spts[2*depth+1].buffer = this;
-		spts[2*depth].bufferIdx = 2*depth;
-		spts[2*depth+1].bufferIdx = 2*depth+1;
-
-		isUsed[2*depth] = false;
-		isUsed[2*depth+1] = false;
-
-		isFirst[2*depth] = false;
-		isFirst[2*depth+1] = false;
+		spts[idx] = NULL;
+		isUsed[idx] = false;
+		isFirst[idx] = false;
 	}
 }
 
 SplitPointBuffer::~SplitPointBuffer()
 {
+	for(int idx = 0; idx < (maxFDepth+1)*2; idx++)
+		delete spts[idx];
 	delete[] spts;
 	delete[] isUsed;
 	delete[] isFirst;
@@ -60,6 +52,26 @@ void SplitPointBuffer::assertEverythingUnused()
 	}
 }
 
+void SplitPointBuffer::reset()
+{
+	for(int idx = 0; idx < (maxFDepth+1)*2; idx++)
+	{
+		isUsed[idx] = false;
+		isFirst[idx] = false;
+
+		SplitPoint* spt = spts[idx];
+		if(spt == NULL)
+			continue;
+		spt->publicNext = NULL;
+		spt->publicPrev = NULL;
+		spt->isPublic = false;
+		spt->publicThreadId = -1;
+		spt->parent = NULL;
+		spt->isAborted = false;
+		spt->isInitialized = false;
+	}
+}
+
 SplitPoint* SplitPointBuffer::acquireSplitPoint(SplitPoint* parent)
 {
 	int fDepth = (parent == NULL) ? 0 : parent->fDepth + 1;
@@ -73,7 +85,17 @@ SplitPoint* SplitPointBuffer::acquireSplitPoint(SplitPoint* parent)
 		idx += 1;
 	}
 
-	SplitPoint* spt = &(spts[idx]);
+	//Only the thread owning this buffer acquires from it, so it is safe to create the SplitPoint here
+	if(spts[idx] == NULL)
+	{
+		SplitPoint* newSpt = new SplitPoint();
+		newSpt->searcher = searcher;
+		newSpt->fDepth = fDepth;
+		newSpt->buffer = this;
+		newSpt->bufferIdx = idx;
+		spts[idx] = newSpt;
+	}
+	SplitPoint* spt = spts[idx];
 
 	isUsed[idx] = true;
 	isFirst[idx] = (parent == NULL || parent->buffer != this);
@@ -90,7 +112,7 @@ bool SplitPointBuffer::freeSplitPoint(SplitPoint* spt)
 {
 	//Ensure it's actually from this buffer!
 	int idx = spt->bufferIdx;
-	DEBUGASSERT(&spts[idx] == spt);
+	DEBUGASSERT(spts[idx] == spt);
 	DEBUGASSERT(!spt->isPublic);
 
 	bool isEmpty = isFirst[idx];
@@ -106,82 +128,165 @@ bool SplitPointBuffer::freeSplitPoint(SplitPoint* spt)
 
 //--------------------------------------------------------------------------------------------------
 
-SearchTree::SearchTree(Searcher* s, int numThr, int maxMSearchDepth, int maxCDepth, const Board& b, const BoardHistory& hist)
+SearchTree::SearchTree(Searcher* s, int numThr, int maxMSD, int maxCD)
 {
 	if(numThr <= 0 || numThr > SearchParams::MAX_THREADS)
 		Global::fatalError(string("Invalid number of threads: ") + Global::intToString(numThr));
 
 	searcher = s;
 	numThreads = numThr;
+	maxMSearchDepth = maxMSD;
+	maxCDepth = maxCD;
+	threadsStarted = false;
 	searchDone = false;
 	iterationGoing = false;
 	didTimeout = false;
 
 	threads = new SearchThread[numThreads];
 	threads[0].isMaster = true;
-	for(int i = 0; i<numThreads; i++)
-		threads[i].initRoot(i,searcher,b,hist,maxCDepth);
 
 	//Overestimated worst case - each thread has an empty buffer, plus each other buffer in use is abandoned and
-	//contains exactly one splitpoint
-	initialNumFreeSptBufs = numThr + numThr*(maxMSearchDepth+1);
-	numFreeSptBufs = initialNumFreeSptBufs;
-	freeSptBufs = new SplitPointBuffer*[numFreeSptBufs];
-	//The max fdepth of splitpoint we need is <= maxMsearchDepth since each fdepth must advance at least one msearch depth.
-	int maxSplitPointFDepthNeeded = maxMSearchDepth;
-	for(int i = 0; i<numFreeSptBufs; i++)
-		freeSptBufs[i] = new SplitPointBuffer(s,maxSplitPointFDepthNeeded);
+	//contains exactly one splitpoint. Buffers are only created as needed, up to this many.
+	maxNumSptBufs = numThr + numThr*(maxMSearchDepth+1);
+	numSptBufs = 0;
+	numFreeSptBufs = 0;
+	allSptBufs = new SplitPointBuffer*[maxNumSptBufs];
+	freeSptBufs = new SplitPointBuffer*[maxNumSptBufs];
 	rootSptBuf = new SplitPointBuffer(s,0);
 
 	rootNode = NULL;
 
-	//Circularly doubly linked list
-	publicizedListHead = new SplitPoint();
-	publicizedListHead->publicNext = publicizedListHead;
-	publicizedListHead->publicPrev = publicizedListHead;
+	publicVersion = 0;
+	numIdle = 0;
 
 	iterationNumWaiting = 0;
 
-	//Create a bunch of threads and start them going
-	boostThreads = new boost::thread[numThreads];
+	job = NULL;
+	jobNumThreads = 0;
+	jobNumPending = 0;
+	jobVersion = 0;
 
-#ifdef MULTITHREADING
-	for(int i = 1; i<numThreads; i++)
-		boostThreads[i] = boost::thread(&runChild,this,searcher,&threads[i]);
-#endif
+	stdThreads = new std::thread[numThreads];
 }
 
 SearchTree::~SearchTree()
 {
-	mutex.lock();
+	stopThreads();
+
+	//Clean up memory
+	delete[] threads;
+	delete[] stdThreads;
+
+	for(int i = 0; i<numSptBufs; i++)
+		delete allSptBufs[i];
+	delete[] allSptBufs;
+	delete[] freeSptBufs;
+
+	delete rootSptBuf;
+}
+
+//Create a bunch of threads and start them going. They wait in runChild until an iteration begins.
+void SearchTree::startThreads()
+{
+	DEBUGASSERT(!threadsStarted);
+	threadsStarted = true;
+	for(int i = 1; i<numThreads; i++)
+		stdThreads[i] = std::thread(&runChild,this,searcher,&threads[i]);
+}
+
+void SearchTree::stopThreads()
+{
+	if(!threadsStarted)
+		return;
+
+	std::unique_lock<std::mutex> lock(mutex);
 	DEBUGASSERT(!iterationGoing);
-	DEBUGASSERT(iterationNumWaiting == numThreads-1);
-	DEBUGASSERT(didTimeout || initialNumFreeSptBufs == numFreeSptBufs);
-	DEBUGASSERT(didTimeout || publicizedListHead->publicNext == publicizedListHead);
-	DEBUGASSERT(didTimeout || publicizedListHead->publicPrev == publicizedListHead);
 	DEBUGASSERT(rootNode == NULL);
 
 	//Mark search done and open the way for threads to exit
 	searchDone = true;
 	iterationCondvar.notify_all();
-	mutex.unlock();
+	lock.unlock();
 
 	//Wait for them all to exit
 	for(int i = 1; i<numThreads; i++)
-		boostThreads[i].join();
+		stdThreads[i].join();
 
 	DEBUGASSERT(iterationNumWaiting == 0);
+	threadsStarted = false;
+}
 
-	//Clean up memory
-	delete publicizedListHead;
-	delete[] threads;
-	delete[] boostThreads;
+bool SearchTree::canSearch(int numThr, int maxMSD)
+{
+	return numThr == numThreads && maxMSD <= maxMSearchDepth;
+}
 
-	for(int i = 0; i<numFreeSptBufs; i++)
-		delete freeSptBufs[i];
-	delete[] freeSptBufs;
+void SearchTree::initSearch(const Board& b, const BoardHistory& hist)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	DEBUGASSERT(!iterationGoing);
+	DEBUGASSERT(rootNode == NULL);
 
-	delete rootSptBuf;
+	//Make sure every child is parked before touching their data
+	while(threadsStarted && iterationNumWaiting != numThreads-1)
+		iterationMasterCondvar.wait(lock);
+
+	//The master is whichever thread is calling us
+	threads[0].allocateLocalMemory();
+	for(int i = 0; i<numThreads; i++)
+		threads[i].initRoot(i,searcher,b,hist,maxCDepth);
+
+	//After a timeout, terminated threads may have left splitpoints and buffers behind, so take everything back
+	if(didTimeout)
+	{
+		for(int i = 0; i<numSptBufs; i++)
+		{
+			allSptBufs[i]->reset();
+			freeSptBufs[i] = allSptBufs[i];
+		}
+		numFreeSptBufs = numSptBufs;
+		rootSptBuf->reset();
+		for(int i = 0; i<numThreads; i++)
+			threads[i].clearPublicList();
+		didTimeout = false;
+	}
+
+	DEBUGASSERT(numSptBufs == numFreeSptBufs);
+	ARIMAADEBUG(
+		for(int i = 0; i<numThreads; i++)
+			DEBUGASSERT(threads[i].publicListHead->publicNext == threads[i].publicListHead);
+	);
+}
+
+void SearchTree::runOnThreads(int numThr, const std::function<void(int)>& f)
+{
+	DEBUGASSERT(numThr >= 1 && numThr <= numThreads);
+	if(numThr <= 1)
+	{
+		f(0);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	DEBUGASSERT(threadsStarted && !iterationGoing);
+
+	//Every child must be parked, so that each one sees the new job exactly once
+	while(iterationNumWaiting != numThreads-1)
+		iterationMasterCondvar.wait(lock);
+
+	job = &f;
+	jobNumThreads = numThr;
+	jobNumPending = numThr-1;
+	jobVersion++;
+	iterationCondvar.notify_all();
+	lock.unlock();
+
+	f(0);
+
+	lock.lock();
+	while(jobNumPending > 0)
+		jobDoneCondvar.wait(lock);
+	job = NULL;
 }
 
 SplitPoint* SearchTree::acquireRootNode()
@@ -202,7 +307,7 @@ void SearchTree::freeRootNode(SplitPoint* spt)
 //Start one iteration of iterative deepening. Call from master thread before starting.
 void SearchTree::beginIteration()
 {
-	boost::lock_guard<boost::mutex> lock(mutex);
+	std::lock_guard<std::mutex> lock(mutex);
 	DEBUGASSERT(!didTimeout); //Cannot start search again if timed out
 	iterationGoing = true;
 	iterationCondvar.notify_all();
@@ -212,7 +317,7 @@ void SearchTree::beginIteration()
 //with the root node.
 void SearchTree::endIterationInternal()
 {
-	boost::unique_lock<boost::mutex> lock(mutex);
+	std::unique_lock<std::mutex> lock(mutex);
 	iterationGoing = false;
 
 	//Notify threads waiting for public work to exit search
@@ -225,12 +330,12 @@ void SearchTree::endIteration()
 {
 	DEBUGASSERT(!iterationGoing);
 
-	boost::unique_lock<boost::mutex> lock(mutex);
+	std::unique_lock<std::mutex> lock(mutex);
 	//Wait for all threads to exit the main running loop
 	while(iterationNumWaiting != numThreads-1)
 		iterationMasterCondvar.wait(lock);
 
-	DEBUGASSERT(didTimeout || initialNumFreeSptBufs == numFreeSptBufs);
+	DEBUGASSERT(didTimeout || numSptBufs == numFreeSptBufs);
 	ARIMAADEBUG(
 		if(!didTimeout)
 			for(int i = 0; i<numFreeSptBufs; i++)
@@ -242,7 +347,7 @@ void SearchTree::endIteration()
 //should exit the main loop
 void SearchTree::timeout(SearchThread* curThread)
 {
-	boost::lock_guard<boost::mutex> lock(mutex);
+	std::lock_guard<std::mutex> lock(mutex);
 	iterationGoing = false;
 	didTimeout = true;
 
@@ -265,8 +370,19 @@ void SearchTree::timeout(SearchThread* curThread)
 //Get a new buffer of splitpoints for this thread to use during search.
 SplitPointBuffer* SearchTree::acquireSplitPointBuffer()
 {
-	boost::lock_guard<boost::mutex> lock(mutex);
-	DEBUGASSERT(numFreeSptBufs > 0);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Need another buffer. Creating it is cheap, the SplitPoints in it are created later by whoever uses them.
+	if(numFreeSptBufs == 0)
+	{
+		if(numSptBufs >= maxNumSptBufs)
+			Global::fatalError("SearchTree: ran out of SplitPointBuffers");
+		//The max fdepth of splitpoint we need is <= maxMsearchDepth since each fdepth must advance at least one msearch depth.
+		SplitPointBuffer* buf = new SplitPointBuffer(searcher,maxMSearchDepth);
+		allSptBufs[numSptBufs] = buf;
+		numSptBufs++;
+		return buf;
+	}
 
 	numFreeSptBufs--;
 	SplitPointBuffer* buf = freeSptBufs[numFreeSptBufs];
@@ -278,52 +394,76 @@ SplitPointBuffer* SearchTree::acquireSplitPointBuffer()
 //Free an unused buffer of splitpoints that has been disowned, or one's own buffer
 void SearchTree::freeSplitPointBuffer(SplitPointBuffer* buf)
 {
-	boost::lock_guard<boost::mutex> lock(mutex);
+	std::lock_guard<std::mutex> lock(mutex);
 	freeSptBufs[numFreeSptBufs] = buf;
 	numFreeSptBufs++;
 
-	DEBUGASSERT(numFreeSptBufs <= initialNumFreeSptBufs);
+	DEBUGASSERT(numFreeSptBufs <= numSptBufs);
 }
 
 //Publicize the SplitPoint so that other threads can help
 //The SplitPoint must be initialized with board data before this is called!
-void SearchTree::publicize(SplitPoint* spt)
+void SearchTree::publicize(SearchThread* curThread, SplitPoint* spt)
 {
-	boost::lock_guard<boost::mutex> lock(mutex);
-
-	DEBUGASSERT(spt->isInitialized);
-	DEBUGASSERT(!spt->isPublic);
-	DEBUGASSERT(spt->publicNext == NULL);
-	DEBUGASSERT(spt->publicPrev == NULL);
-	spt->isPublic = true;
-
-	//Insert into doubly linked public list
-	spt->publicNext = publicizedListHead->publicNext;
-	spt->publicPrev = publicizedListHead;
-	publicizedListHead->publicNext->publicPrev = spt;
-	publicizedListHead->publicNext = spt;
+	{
+		std::lock_guard<std::mutex> lock(curThread->publicMutex);
+
+		DEBUGASSERT(spt->isInitialized);
+		DEBUGASSERT(!spt->isPublic);
+		DEBUGASSERT(spt->publicNext == NULL);
+		DEBUGASSERT(spt->publicPrev == NULL);
+		spt->isPublic = true;
+		spt->publicThreadId = curThread->id;
+
+		//Insert into doubly linked public list, keeping it sorted by cDepth. Usually the new splitpoint is the deepest,
+		//so search from the back
+		SplitPoint* head = curThread->publicListHead;
+		SplitPoint* prev = head->publicPrev;
+		while(prev != head && prev->cDepth > spt->cDepth)
+			prev = prev->publicPrev;
+		spt->publicNext = prev->publicNext;
+		spt->publicPrev = prev;
+		prev->publicNext->publicPrev = spt;
+		prev->publicNext = spt;
+
+		curThread->publicMinCDepth = head->publicNext->cDepth;
+	}
 
-	publicWorkCondvar.notify_all();
+	//Wake up free threads, if any. Paired with the check of publicVersion in getPublicWork, whichever of the two
+	//sides goes second sees the other.
+	publicVersion++;
+	if(numIdle > 0)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		publicWorkCondvar.notify_all();
+	}
 }
 
 //Depublicize the SplitPoint. Call before this splitpoint back to buffer.
 //Okay to call for splitpoints that aren't public
 void SearchTree::depublicize(SplitPoint* spt)
 {
-	//if(spt->isPublic) //TODO is this double check a good idea?
-	boost::lock_guard<boost::mutex> lock(mutex); //TODO is this lock necessary?
-	if(spt->isPublic)
-	{
-		DEBUGASSERT(spt->publicNext != NULL);
-		DEBUGASSERT(spt->publicPrev != NULL);
+	//Safe to read without the lock - the splitpoint is done, so nobody is going to publicize it concurrently
+	int threadId = spt->publicThreadId;
+	if(threadId < 0)
+		return;
 
-		//Remove from doubly linked list
-		spt->publicNext->publicPrev = spt->publicPrev;
-		spt->publicPrev->publicNext = spt->publicNext;
-		spt->publicNext = NULL;
-		spt->publicPrev = NULL;
-		spt->isPublic = false;
-	}
+	SearchThread* pubThread = &threads[threadId];
+	std::lock_guard<std::mutex> lock(pubThread->publicMutex);
+	DEBUGASSERT(spt->isPublic);
+	DEBUGASSERT(spt->publicNext != NULL);
+	DEBUGASSERT(spt->publicPrev != NULL);
+
+	//Remove from doubly linked list
+	spt->publicNext->publicPrev = spt->publicPrev;
+	spt->publicPrev->publicNext = spt->publicNext;
+	spt->publicNext = NULL;
+	spt->publicPrev = NULL;
+	spt->isPublic = false;
+	spt->publicThreadId = -1;
+
+	SplitPoint* head = pubThread->publicListHead;
+	pubThread->publicMinCDepth = (head->publicNext == head) ? SearchThread::NO_PUBLIC_WORK : head->publicNext->cDepth;
 }
 
 //Find a good publicized SplitPoint and get work from it for the given thread.
@@ -333,42 +473,85 @@ void SearchTree::getPublicWork(SearchThread* curThread)
 {
 	DEBUGASSERT(curThread->lockedSpt == NULL);
 	DEBUGASSERT(!curThread->hasWork());
-	boost::unique_lock<boost::mutex> lock(mutex);
 
 	while(true)
 	{
-		//We're done, folks
-		if(!iterationGoing || curThread->isTerminated)
-		{DEBUGASSERT(!curThread->hasWork()); return;}
-
-		SplitPoint* bestSpt = NULL;
-		for(SplitPoint* spt = publicizedListHead->publicNext; spt != publicizedListHead; spt = spt->publicNext)
+		int64_t version = publicVersion;
 		{
-			spt->lock(curThread);
+			std::lock_guard<std::mutex> lock(mutex);
 
-			//Get the first public splitpoint with work
-			if(spt->getWork(curThread))
-			{
-				//Woohoo, we got work!
-				bestSpt = spt;
-				spt->unlock(curThread);
-				curThread->syncWithCurSplitPointDistant();
-				curThread->stats.publicWorkRequests++;
-				curThread->stats.publicWorkDepthSum += spt->cDepth;
-				break;
-			}
-			spt->unlock(curThread);
+			//We're done, folks
+			if(!iterationGoing || curThread->isTerminated)
+			{DEBUGASSERT(!curThread->hasWork()); return;}
 		}
 
 		//Found work!
-		if(bestSpt != NULL)
-		{DEBUGASSERT(curThread->hasWork()); return;}
+		if(tryGetPublicWork(curThread))
+		{
+			DEBUGASSERT(curThread->hasWork());
+			curThread->syncWithCurSplitPointDistant();
+			return;
+		}
 
-		//Don't have to check if(!iterationGoing) because we've held the mutex the whole time and checked at the top
-		publicWorkCondvar.wait(lock);
+		//Nothing available, wait until something new is publicized or the iteration ends
+		std::unique_lock<std::mutex> lock(mutex);
+		numIdle++;
+		while(iterationGoing && !curThread->isTerminated && publicVersion == version)
+			publicWorkCondvar.wait(lock);
+		numIdle--;
 	}
 }
 
+//Try once to grab work from the publicized SplitPoints, shallowest first. Does not block.
+bool SearchTree::tryGetPublicWork(SearchThread* curThread)
+{
+	//The thread advertising the shallowest splitpoint first
+	int bestId = -1;
+	int bestCDepth = SearchThread::NO_PUBLIC_WORK;
+	for(int i = 0; i<numThreads; i++)
+	{
+		int cDepth = threads[i].publicMinCDepth;
+		if(cDepth < bestCDepth)
+		{bestId = i; bestCDepth = cDepth;}
+	}
+	if(bestId < 0)
+		return false;
+	if(tryGetPublicWork(curThread,&threads[bestId]))
+		return true;
+
+	//Its splitpoints had no moves left to start, so try everyone else
+	for(int j = 1; j<numThreads; j++)
+	{
+		int i = (bestId + j) % numThreads;
+		if(threads[i].publicMinCDepth != SearchThread::NO_PUBLIC_WORK && tryGetPublicWork(curThread,&threads[i]))
+			return true;
+	}
+	return false;
+}
+
+bool SearchTree::tryGetPublicWork(SearchThread* curThread, SearchThread* fromThread)
+{
+	//Holding the list's lock keeps its splitpoints from being depublicized and recycled while we look at them
+	std::lock_guard<std::mutex> lock(fromThread->publicMutex);
+	SplitPoint* head = fromThread->publicListHead;
+	for(SplitPoint* spt = head->publicNext; spt != head; spt = spt->publicNext)
+	{
+		spt->lock(curThread);
+
+		//Get the first public splitpoint with work
+		if(spt->getWork(curThread))
+		{
+			//Woohoo, we got work!
+			spt->unlock(curThread);
+			curThread->stats.publicWorkRequests++;
+			curThread->stats.publicWorkDepthSum += spt->cDepth;
+			return true;
+		}
+		spt->unlock(curThread);
+	}
+	return false;
+}
+
 //Return the master thread
 SearchThread* SearchTree::getMasterThread()
 {
@@ -387,7 +570,10 @@ SearchStats SearchTree::getCombinedStats()
 
 void SearchTree::runChild(SearchTree* tree, Searcher* searcher, SearchThread* curThread)
 {
-	boost::unique_lock<boost::mutex> lock(tree->mutex);
+	curThread->allocateLocalMemory();
+
+	std::unique_lock<std::mutex> lock(tree->mutex);
+	int64_t jobVersion = tree->jobVersion;
 	while(true)
 	{
 		if(tree->searchDone)
@@ -399,6 +585,20 @@ void SearchTree::runChild(SearchTree* tree, Searcher* searcher, SearchThread* cu
 			searcher->mainLoop(curThread);
 			lock.lock();
 		}
+		else if(tree->jobVersion != jobVersion)
+		{
+			jobVersion = tree->jobVersion;
+			if(curThread->id < tree->jobNumThreads)
+			{
+				const std::function<void(int)>* job = tree->job;
+				lock.unlock();
+				(*job)(curThread->id);
+				lock.lock();
+				tree->jobNumPending--;
+				if(tree->jobNumPending == 0)
+					tree->jobDoneCondvar.notify_all();
+			}
+		}
 		else
 		{
 			tree->iterationNumWaiting++;
@@ -435,6 +635,7 @@ SplitPoint::SplitPoint()
 	publicNext = NULL;
 	publicPrev = NULL;
 	isPublic = false;
+	publicThreadId = -1;
 
 	parent = NULL;
 	isAborted = false;
@@ -828,6 +1029,56 @@ void SplitPoint::reportResult(eval_t eval, int moveIdx, move_t move, move_t* chi
 }
 
 
+//FEATUREPOSDATACACHE -------------------------------------------------
+
+FeaturePosDataCache::FeaturePosDataCache()
+:exponent(0),size(0),mask(0),hashes(NULL),setIds(NULL),data(NULL)
+{}
+
+FeaturePosDataCache::~FeaturePosDataCache()
+{
+	delete[] hashes;
+	delete[] setIds;
+	delete[] data;
+}
+
+void FeaturePosDataCache::init(int exp)
+{
+	if(data == NULL || exp != exponent)
+	{
+		delete[] hashes;
+		delete[] setIds;
+		delete[] data;
+		exponent = exp;
+		size = 1 << exp;
+		mask = size-1;
+		hashes = new hash_t[size];
+		setIds = new int[size];
+		data = new FeaturePosData[size];
+	}
+	clear();
+}
+
+void FeaturePosDataCache::clear()
+{
+	for(int i = 0; i<size; i++)
+		setIds[i] = -1;
+}
+
+const FeaturePosData& FeaturePosDataCache::get(const ArimaaFeatureSet& afset, int setId, const Board& turnBoard, const BoardHistory& hist)
+{
+	//Offset by the set so that a turn board used with both sets doesn't thrash a single slot
+	hash_t hash = turnBoard.sitCurrentHash;
+	int idx = (int)((hash + setId) & mask);
+	if(setIds[idx] != setId || hashes[idx] != hash)
+	{
+		afset.getPosData(turnBoard,hist,turnBoard.player,data[idx]);
+		hashes[idx] = hash;
+		setIds[idx] = setId;
+	}
+	return data[idx];
+}
+
 //SEARCHTHREAD --------------------------------------------------------
 
 SearchThread::SearchThread()
@@ -835,10 +1086,8 @@ SearchThread::SearchThread()
 	id = -1;
 	searcher = NULL;
 
-	pv = new move_t*[SearchParams::PV_ARRAY_SIZE];
-	for(int i = 0; i<SearchParams::PV_ARRAY_SIZE; i++)
-		pv[i] = new move_t[SearchParams::PV_ARRAY_SIZE];
-	pvLen = new int[SearchParams::PV_ARRAY_SIZE];
+	pv = NULL;
+	pvLen = NULL;
 
 	mainBoardTurnNumber = 0;
 	curSplitPoint = NULL;
@@ -849,9 +1098,17 @@ SearchThread::SearchThread()
 	timeCheckCounter = 0;
 	lockedSpt = NULL;
 
-	mvListCapacity = SearchParams::QMAX_FDEPTH * SearchParams::QSEARCH_MOVE_CAPACITY;
-	mvList = new move_t[mvListCapacity];
-	hmList = new int[mvListCapacity];
+	killerMoves = NULL;
+	killerMovesLen = 0;
+	killerMovesArrayLen = 0;
+
+	//Circularly doubly linked list
+	publicListHead = new SplitPoint();
+	clearPublicList();
+
+	mvList = NULL;
+	hmList = NULL;
+	mvListCapacity = 0;
 	mvListCapacityUsed = 0;
 }
 
@@ -861,30 +1118,65 @@ SearchThread::~SearchThread()
 	delete[] hmList;
 
 	delete[] killerMoves;
+	delete publicListHead;
 
-	for(int i = 0; i<SearchParams::PV_ARRAY_SIZE; i++)
-		delete[] pv[i];
-	delete[] pv;
+	if(pv != NULL)
+	{
+		for(int i = 0; i<SearchParams::PV_ARRAY_SIZE; i++)
+			delete[] pv[i];
+		delete[] pv;
+	}
 	delete[] pvLen;
 }
 
+void SearchThread::allocateLocalMemory()
+{
+	if(mvList != NULL)
+		return;
+
+	pv = new move_t*[SearchParams::PV_ARRAY_SIZE];
+	for(int i = 0; i<SearchParams::PV_ARRAY_SIZE; i++)
+		pv[i] = new move_t[SearchParams::PV_ARRAY_SIZE];
+	pvLen = new int[SearchParams::PV_ARRAY_SIZE];
+
+	mvListCapacity = SearchParams::QMAX_FDEPTH * SearchParams::QSEARCH_MOVE_CAPACITY;
+	mvList = new move_t[mvListCapacity];
+	hmList = new int[mvListCapacity];
+}
+
 //Initialize this search thread to be ready to search for the given root position
 void SearchThread::initRoot(int i, Searcher* s, const Board& b, const BoardHistory& hist, int maxCDepth)
 {
 	id = i;
 	searcher = s;
+	stats = SearchStats();
 	mainBoardTurnNumber = b.turnNumber;
 	boardHistory = hist;
+	featurePosCache.init(s->params.featurePosCacheExp);
 	curSplitPoint = NULL;
+	curSplitPointBuffer = NULL;
 	isTerminated = false;
 	timeCheckCounter = 0;
+	lockedSpt = NULL;
+	mvListCapacityUsed = 0;
 
 	int killerLen = maxCDepth+1;
-	killerMoves = new move_t[killerLen];
-	for(int j = 0; j<killerLen; j++)
+	if(killerMovesArrayLen < killerLen)
+	{
+		delete[] killerMoves;
+		killerMoves = new move_t[killerLen];
+		killerMovesArrayLen = killerLen;
+	}
+	for(int j = 0; j<killerMovesArrayLen; j++)
 	  killerMoves[j] = ERRORMOVE;
 	killerMovesLen = 0;
-	killerMovesArrayLen = killerLen;
+}
+
+void SearchThread::clearPublicList()
+{
+	publicListHead->publicNext = publicListHead;
+	publicListHead->publicPrev = publicListHead;
+	publicMinCDepth = NO_PUBLIC_WORK;
 }
 
 bool SearchThread::hasWork()
@@ -1126,7 +1418,7 @@ void Searcher::work(SearchThread* curThread)
 			spt->unlock(curThread);
 
 			if(needsPublication)
-				searchTree->publicize(spt);
+				searchTree->publicize(curThread,spt);
 
 			return;
 		}
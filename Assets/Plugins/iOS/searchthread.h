@@ -7,46 +7,13 @@
 #ifndef SEARCHTHREAD_H_
 #define SEARCHTHREAD_H_
 
-#define BOOST_USE_WINDOWS_H
 #include <vector>
 #include <set>
-
-#ifdef MULTITHREADING
-#include <boost/thread.hpp>
-#else
-namespace boost
-{
-  class mutex
-  { public:
-    inline void lock() {};
-    inline void unlock() {};
-  };
-  class thread
-  { public:
-    inline thread() {};
-    inline void join() {};
-  };
-  template <class T>
-  class unique_lock
-  { public:
-    unique_lock(T t) {};
-    inline void lock() {};
-    inline void unlock() {};
-  };
-  template <class T>
-  class lock_guard
-  { public:
-    lock_guard(T t) {};
-  };
-  class condition_variable
-  { public:
-    inline void notify_all() {};
-    template <class T>
-    inline void wait(unique_lock<T> lock) {};
-  };
-}
-#endif
-
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
 
 #include "board.h"
 #include "search.h"
@@ -73,9 +40,17 @@ class SearchTree;
 //finished, the SplitPoint is freed. This allocation is not done dynamically, but rather from preallocated
 //SplitPointBuffers (see below).
 //
-//Whenever a thread wishes, it can publicize the SplitPoint it is working on, adding it to a global list
+//Whenever a thread wishes, it can publicize the SplitPoint it is working on, adding it to that thread's list
 //of available work for free threads. Critical SplitPoint operations are performed with a per-SplitPoint mutex.
 //
+//Public work-----------------
+//
+//Each thread has its own list of the SplitPoints it publicized, ordered from shallowest to deepest and guarded by
+//its own publicMutex, so publicizing and depublicizing (which happen at every split) never contend on one global lock.
+//A free thread steals from the thread advertising the shallowest public SplitPoint first, since shallow work is the
+//largest and least likely to be cut off, then from everyone else. Free threads that find nothing sleep on the tree's
+//publicWorkCondvar until the next publication or the end of the iteration.
+//
 //Every SplitPoint must always have at least one thread working on it or a subtree extending from it. To maintain
 //this invariant, the last thread to finish working at a SplitPoint and finish the SplitPoint must back up to the
 //parent and then begin working on the parent. This may or may not be the thread that created the SplitPoint to
@@ -87,11 +62,16 @@ class SearchTree;
 //
 //SplitPointBuffers------------
 //
-//SplitPoints are never dynamically allocated, but rather are allocated all at the start of search in buffers.
-//Each buffer is designed for use by one thread, and contains two splitpoints per fDepth, which is the most that
+//SplitPoints are never allocated per node, but rather kept in buffers that live as long as the SearchTree.
+//Each buffer is designed for use by one thread, and has room for two splitpoints per fDepth, which is the most that
 //should ever be necessary (a second is needed, briefly, when finishing a splitpoint produces another at the
 //same depth, such as during null move or lmr).
 //
+//Both the buffers and the SplitPoints in them are only created the first time they are needed, so memory grows
+//with how the search actually goes rather than with the worst case over numThreads * maxMSearchDepth^2. Since a
+//SplitPoint is created by the thread that first uses it (as are each thread's own arrays, see
+//SearchThread::allocateLocalMemory), on NUMA machines the usual first-touch policy puts it on that thread's node.
+//
 //A thread can request a buffer from the SearchTree, at which point it exclusively owns the buffer and can get
 //and free SplitPoints without synchronization.
 //
@@ -119,8 +99,9 @@ class SearchTree;
 struct SplitPointBuffer
 {
 	private:
+	Searcher* searcher;
 	int maxFDepth;        //Max fDepth that we have SplitPoints for
-	SplitPoint* spts;     //Array of buffered SplitPoints
+	SplitPoint** spts;    //Array of buffered SplitPoints, each created on first use
 	bool* isUsed;         //Indicates which SplitPoints are used
 	bool* isFirst;        //Indicates whether this SplitPoint is the first allocated in the buffer
 
@@ -131,6 +112,9 @@ struct SplitPointBuffer
 	//Error checking function
 	void assertEverythingUnused();
 
+	//Mark every SplitPoint unused, including any left behind by threads terminated on timeout
+	void reset();
+
 	//Get a SplitPoint for the given fDepth.
 	SplitPoint* acquireSplitPoint(SplitPoint* parent);
 
@@ -151,6 +135,9 @@ class SearchTree
 
 	//Search data
 	int numThreads;         //Number of threads
+	int maxMSearchDepth;    //Max msearch depth that the SplitPointBuffers are sized for
+	int maxCDepth;          //Max cDepth that the threads are sized for
+	bool threadsStarted;    //Have the child threads been started and not yet stopped?
 	bool searchDone;        //Is the current entire search done? Controls gate for threads to completely exit
 	bool iterationGoing;    //Is an iteration of search in progress? Controls transition in and out of main loop
 	bool didTimeout;        //Indicates whether timeout occured or not. Search cannot be restarted after timeout
@@ -158,42 +145,64 @@ class SearchTree
 	SearchThread* threads; 	//Array of all threads
 
 	//SplitPoint buffers
-	int initialNumFreeSptBufs;      //How many are there initially?
-	int numFreeSptBufs;             //How many are there?
+	int maxNumSptBufs;              //Max number of buffers that could ever be needed at once
+	int numSptBufs;                 //How many have been created so far?
+	SplitPointBuffer** allSptBufs;  //All the buffers created, whether free or not
+	int numFreeSptBufs;             //How many are available?
 	SplitPointBuffer** freeSptBufs; //Array of SplitPoint buffers available to be handed out
 	SplitPointBuffer* rootSptBuf;   //Special buffer whose only job is to contain the root node
 
 	//Root node of search
 	SplitPoint* rootNode;
 
-	//Publicized splitpoints - SplitPoints that are available work for free threads.
-	//Intrusive list using publicNext and publicPrev pointers in splitpoint
-	//Head node is a dummy splitpoint, unused.
-	SplitPoint* publicizedListHead;
+	//Publicized splitpoints are kept in per-thread lists, see SearchThread::publicListHead
+	std::atomic<int64_t> publicVersion; //Incremented on every publication, so free threads know to look again
+	std::atomic<int> numIdle;           //Number of free threads waiting on publicWorkCondvar
 
-	//Actual boost library thread objects
-	boost::thread* boostThreads;
+	//Actual std library thread objects, index 0 unused since the master is the thread that calls searchID
+	std::thread* stdThreads;
 
 	//Synchronization
-	boost::mutex mutex;
-	boost::condition_variable publicWorkCondvar;
+	std::mutex mutex;
+	std::condition_variable publicWorkCondvar;
 
 	int iterationNumWaiting;
-	boost::condition_variable iterationCondvar;
-	boost::condition_variable iterationMasterCondvar;
+	std::condition_variable iterationCondvar;
+	std::condition_variable iterationMasterCondvar;
+
+	//Work handed to the parked threads between iterations, see runOnThreads
+	const std::function<void(int)>* job;
+	int jobNumThreads;       //Threads with id below this run the job
+	int jobNumPending;       //Child threads that have not yet finished it
+	int64_t jobVersion;      //Incremented for each new job
+	std::condition_variable jobDoneCondvar;
 
 	public:
-	SearchTree(Searcher* searcher, int numThreads, int maxMSearchDepth, int maxCDepth, const Board& b, const BoardHistory& hist);
+	//The tree, its threads and its SplitPointBuffers are meant to be kept for many searches, with initSearch
+	//called before each one.
+	SearchTree(Searcher* searcher, int numThreads, int maxMSearchDepth, int maxCDepth);
 	~SearchTree();
 
 	//SEARCH INTERFACE------------------------------------------------
 
-	//Start all the child threads, can call just after construction
+	//Start all the child threads, can call just after construction. Between searches they wait on iterationCondvar.
 	void startThreads();
 
-	//Stop all the child threads, can call just before destruction
+	//Stop all the child threads, can call just before destruction (the destructor calls it if not already done)
 	void stopThreads();
 
+	//Can this tree be used for a search with the given number of threads and max msearch depth?
+	bool canSearch(int numThreads, int maxMSearchDepth);
+
+	//Prepare all threads and buffers to search the given position. Call from the master thread before each search,
+	//while no iteration is going.
+	void initSearch(const Board& b, const BoardHistory& hist);
+
+	//Call job(i) for each i in [0,numThreads) concurrently, job(0) on the calling thread and the others on the parked
+	//child threads with those ids, returning once all are done. Call from the master thread while no iteration is
+	//going, such as between initSearch and the first iteration. numThreads must be at most the number of threads.
+	void runOnThreads(int numThreads, const std::function<void(int)>& job);
+
 	//Get the root node, for the purposes of initialization
 	SplitPoint* acquireRootNode();
 
@@ -222,14 +231,18 @@ class SearchTree
 	//Free an unused buffer of splitpoints that has been disowned, or one's own buffer
 	void freeSplitPointBuffer(SplitPointBuffer* buf);
 
-	//Publicize the SplitPoint so that other threads can help
+	//Publicize the SplitPoint so that other threads can help, adding it to the given thread's list
 	//The SplitPoint must be initialized with board data before this is called!
-	void publicize(SplitPoint* spt);
+	void publicize(SearchThread* curThread, SplitPoint* spt);
 
 	//Depublicize the SplitPoint. Call only when returning this splitpoint back to buffer.
 	//Okay to call for splitpoints that aren't public
 	void depublicize(SplitPoint* spt);
 
+	//Try once to grab work from the publicized SplitPoints, shallowest first. Does not block.
+	bool tryGetPublicWork(SearchThread* thread);
+	bool tryGetPublicWork(SearchThread* thread, SearchThread* fromThread);
+
 	//Find a good publicized SplitPoint and grab work from it for the given thread.
 	//If none, blocks until there is some. Threads only return without work when:
 	// 1) They are the master thread and the search is done
@@ -277,18 +290,19 @@ struct SplitPoint
 	SplitPointBuffer* buffer; //The SplitPointBuffer containing this splitpoint
 	int bufferIdx;            //The index of this splitpoint in the buffer
 
-	//Data synchronized under Searchtree------------------------------------------------------------
+	//Data synchronized under the publicMutex of the thread that publicized it-------------------------
 
-	//Intrusive doubly-linked list for SearchTree::publicizedListHead
+	//Intrusive doubly-linked list for SearchThread::publicListHead
 	SplitPoint* publicNext;
 	SplitPoint* publicPrev;
 	bool isPublic;
+	int publicThreadId; //The thread whose list this is in, or -1
 
 	//Data synchronized under SplitPoint------------------------------------------------------------
 
 	//Mutex---------------------------
 	private:
-	boost::mutex mutex;
+	std::mutex mutex;
 	public:
 
 	//Splitpoint Buffer Data-------------------
@@ -405,6 +419,33 @@ struct SplitPoint
 
 };
 
+//Per-thread cache of the FeaturePosData for tree move ordering, keyed by the hash of the turn board and by which
+//feature set computed it. Direct mapped with a fixed number of entries, so a turn board simply replaces whatever
+//was in its slot, and sibling turns deep in the tree don't each recompute the data of the turns above them.
+struct FeaturePosDataCache
+{
+	int exponent;
+	int size;
+	int mask;
+	hash_t* hashes;
+	int* setIds; //Which feature set computed each entry, -1 if empty
+	FeaturePosData* data;
+
+	FeaturePosDataCache();
+	~FeaturePosDataCache();
+
+	//Allocate 2**exponent entries if not already that size, and clear
+	void init(int exponent);
+	void clear();
+
+	//Get the data for turnBoard computed by afset, computing and caching it if not present
+	const FeaturePosData& get(const ArimaaFeatureSet& afset, int setId, const Board& turnBoard, const BoardHistory& hist);
+
+	private:
+	FeaturePosDataCache(const FeaturePosDataCache&);
+	FeaturePosDataCache& operator=(const FeaturePosDataCache&);
+};
+
 struct SearchThread
 {
 	//Thread id
@@ -425,8 +466,8 @@ struct SearchThread
 	BoardHistory boardHistory;
 
 	//MOVE FEATURE DATA-------------------------------------------------------------
-	vector<hash_t> featurePosDataHash;     //Hash of turnBoard from which featurePosData computed
-	vector<FeaturePosData> featurePosData; //Stack of FeaturePosDatas for each turn.
+	FeaturePosDataCache featurePosCache; //FeaturePosDatas for the turn boards of recently searched nodes
+	FeatureBuffer featureBuffer;         //Scratch space for extracting the features of each move
 
 	//KILLERS----------------------------------------------------------------------
 	//READ BY OTHER THREADS!!!
@@ -438,6 +479,7 @@ struct SearchThread
 
 	//MOVE GENERATION --------------------------------------------------------------
 	//Move buffers for each fdepth of search, in case we don't use a SplitPoint (such as in qsearch)
+	//This and the pv arrays are allocated by allocateLocalMemory.
 	move_t* mvList;
 	int* hmList;
 	int mvListCapacity;
@@ -464,13 +506,24 @@ struct SearchThread
 	//SYNCHRONIZATION--------------------------------------------------------------
 	SplitPoint* lockedSpt; //If locking or about to lock an spt, store here
 
+	//PUBLIC WORK------------------------------------------------------------------
+	//READ BY OTHER THREADS, all under publicMutex except for publicMinCDepth, which is only a hint
+	std::mutex publicMutex;
+	SplitPoint* publicListHead;           //Circular list of SplitPoints publicized by this thread, by increasing cDepth. Dummy head.
+	std::atomic<int> publicMinCDepth;     //cDepth of the shallowest SplitPoint in the list, or NO_PUBLIC_WORK
+	static const int NO_PUBLIC_WORK = 0x7FFFFFFF;
+
 
 	//METHODS========================================================================
 	SearchThread();
 	~SearchThread();
 
+	//Allocate the large per-thread arrays, if not done already. Call from the thread that will use them, so
+	//that on NUMA machines they are placed on its node.
+	void allocateLocalMemory();
+
 	//Initialize this search thread to be ready to search for the given root position
-	//Called only once, at the start of search before any iterations
+	//Called at the start of each search before any iterations
 	void initRoot(int id, Searcher* searcher, const Board& b, const BoardHistory& hist, int maxCDepth);
 
 	//Search control logic------------------------------------
@@ -493,6 +546,9 @@ struct SearchThread
 
 	//Misc-----------------------------------------------------
 
+	//Empty the list of public splitpoints, without unlinking them. Only for when the whole tree is reset.
+	void clearPublicList();
+
 	//Initialize or reinitialize this search thread to be ready to search from the given point
 	//Must pass in the turn number of the initial board, so we can sync histories
 	void init(SplitPoint* pt, int mainBoardTurnNumber);
@@ -4,6 +4,9 @@
  */
 #include "pch.h"
 
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
 #include "global.h"
 #include "rand.h"
 #include "board.h"
@@ -316,6 +319,263 @@ void SearchUtils::genFullMoves(const Board& board, const BoardHistory& hist,
 	}
 }
 
+//A position reached during parallel full move generation. key orders nodes the same as the single threaded DFS
+//would first reach them: the index+1 of the move taken at each level from the root, 16 bits per level,
+//most significant first, so that shorter paths sort before their extensions.
+struct FullMoveNode
+{
+	hash_t hash;
+	uint64_t key;
+	move_t move;
+	int ns;
+	int depth;
+	bool isLeaf; //Whether this position ends a full move, so has no children
+};
+
+static bool fullMoveNodeKeyLess(const FullMoveNode& n0, const FullMoveNode& n1)
+{
+	return n0.key < n1.key;
+}
+
+//Blocks the threads of genFullMovesParallel until all of them reach it, reusable across rounds
+class FullMoveBarrier
+{
+	std::mutex mutex;
+	std::condition_variable cond;
+	int numThreads;
+	int numWaiting;
+	int round;
+
+	public:
+	FullMoveBarrier(int n)
+	:numThreads(n),numWaiting(0),round(0)
+	{}
+
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		int r = round;
+		if(++numWaiting == numThreads)
+		{
+			numWaiting = 0;
+			round++;
+			cond.notify_all();
+		}
+		else
+			cond.wait(lock, [this,r]() {return round != r;});
+	}
+};
+
+//Shared state for one parallel generation. Layer L holds the distinct positions after exactly L steps, and is
+//stored as one shard per thread, split by hash.
+struct FullMoveGenShared
+{
+	const Board* b;
+	const BoardHistory* hist;
+	int maxSteps;
+	bool winLossPrune;
+	int numThreads;
+	FullMoveBarrier barrier;
+
+	vector<vector<vector<vector<FullMoveNode> > > > children; //[thread][layer][shard], as generated, with duplicates
+	vector<vector<vector<FullMoveNode> > > shards;   //[shard][layer], distinct, each with its least key
+	vector<vector<int> > shardSlots;                 //[shard], open addressed index into the shard being merged
+	vector<vector<FullMoveNode> > leaves;            //[thread]
+
+	FullMoveGenShared(const Board& board, const BoardHistory& h, int steps, bool wlp, int n)
+	:b(&board),hist(&h),maxSteps(steps),winLossPrune(wlp),numThreads(n),barrier(n),
+	 children(n,vector<vector<vector<FullMoveNode> > >(steps+2,vector<vector<FullMoveNode> >(n))),
+	 shards(n,vector<vector<FullMoveNode> >(steps+2)),
+	 shardSlots(n),
+	 leaves(n)
+	{}
+};
+
+//The same condition as genFullMoveHelper for b after ns steps to end a full move
+static bool isFullMoveLeaf(const FullMoveGenShared& sh, Board& b, int ns)
+{
+	return sh.maxSteps - ns <= 0 || b.player != sh.b->player ||
+			(b.step != 0 && SearchUtils::isTerminalEval(SearchUtils::checkGameEndConditions(b,*sh.hist,ns)));
+}
+
+//Expand one position exactly as genFullMoveHelper would, recording it as a leaf or its children
+static void expandFullMoveNode(FullMoveGenShared& sh, const FullMoveNode& node, int thread)
+{
+	if(node.isLeaf)
+	{
+		sh.leaves[thread].push_back(node);
+		return;
+	}
+
+	const Board& root = *sh.b;
+	Board b = root;
+	if(node.ns > 0)
+		b.makeMove(node.move);
+	pla_t pla = root.player;
+
+	move_t mv[256];
+	int num = 0;
+	if(sh.winLossPrune)
+		num = SearchUtils::genWinConditionMoves(b,mv,NULL,4-b.step);
+	if(num == 0 || num == -1)
+	{
+		num = 0;
+		if(b.step < 3)
+			num += BoardMoveGen::genPushPulls(b,pla,mv+num);
+		num += BoardMoveGen::genSteps(b,pla,mv+num);
+		if(b.step != 0)
+			mv[num++] = PASSMOVE;
+	}
+	DEBUGASSERT(num < 0xFFFF);
+
+	vector<vector<vector<FullMoveNode> > >& children = sh.children[thread];
+	for(int i = 0; i<num; i++)
+	{
+		Board copy = b;
+		copy.makeMove(mv[i]);
+		if(copy.posCurrentHash == root.posCurrentHash)
+			continue;
+		FullMoveNode child;
+		child.hash = copy.sitCurrentHash;
+		child.key = node.key | ((uint64_t)(i+1) << (16*(3-node.depth)));
+		child.move = Board::concatMoves(node.move,mv[i],node.ns);
+		child.ns = node.ns + Board::numStepsInMove(mv[i]);
+		child.depth = node.depth+1;
+		child.isLeaf = isFullMoveLeaf(sh,copy,child.ns);
+		children[child.ns][(child.hash >> 32) % sh.numThreads].push_back(child);
+	}
+}
+
+//Merge all generated children in this thread's shard of the layer, keeping the least key for each position
+static void mergeFullMoveShard(FullMoveGenShared& sh, int layer, int thread)
+{
+	int total = 0;
+	for(int t = 0; t<sh.numThreads; t++)
+		total += sh.children[t][layer][thread].size();
+	if(total == 0)
+		return;
+
+	int size = 16;
+	while(size < total*2)
+		size *= 2;
+	int mask = size-1;
+	vector<int>& slots = sh.shardSlots[thread];
+	slots.assign(size,-1);
+
+	vector<FullMoveNode>& shard = sh.shards[thread][layer];
+	for(int t = 0; t<sh.numThreads; t++)
+	{
+		const vector<FullMoveNode>& children = sh.children[t][layer][thread];
+		for(int i = 0; i<(int)children.size(); i++)
+		{
+			const FullMoveNode& child = children[i];
+			int idx = (int)(child.hash & mask);
+			for(; slots[idx] != -1; idx = (idx+1) & mask)
+				if(shard[slots[idx]].hash == child.hash)
+					break;
+			if(slots[idx] == -1)
+			{
+				slots[idx] = shard.size();
+				shard.push_back(child);
+			}
+			else if(child.key < shard[slots[idx]].key)
+				shard[slots[idx]] = child;
+		}
+	}
+}
+
+static void genFullMovesParallelThread(FullMoveGenShared& sh, int thread)
+{
+	int numLayers = sh.maxSteps+2;
+	int numThreads = sh.numThreads;
+	for(int layer = 0; layer<numLayers; layer++)
+	{
+		//All children in this layer come from the two layers before it, which are done
+		if(layer > 0)
+		{
+			mergeFullMoveShard(sh,layer,thread);
+			sh.barrier.wait();
+		}
+
+		//Expand the layer round robin across all shards
+		int idx = 0;
+		for(int s = 0; s<numThreads; s++)
+		{
+			const vector<FullMoveNode>& shard = sh.shards[s][layer];
+			for(int i = 0; i<(int)shard.size(); i++, idx++)
+				if(idx % numThreads == thread)
+					expandFullMoveNode(sh,shard[i],thread);
+		}
+		sh.barrier.wait();
+	}
+}
+
+//A full move's last position is first reached by the DFS of genFullMoveHelper along the least path to it in the
+//order the moves are generated at each level, and the moves are emitted in that order. Every prefix of a least
+//path is itself a least path, so expanding the distinct positions layer by layer in steps and keeping the least
+//key for each one finds every full move with the path that the DFS would take to it, and sorting by key gives
+//the DFS order. Pass moves make the same position reachable in different layers, so leaves are deduplicated
+//once more at the end.
+static void genFullMovesParallelHelper(const Board& b, const BoardHistory& hist, vector<move_t>& moves, int maxSteps,
+		bool winLossPrune, int numThreads, const function<void(int,const function<void(int)>&)>& runOnThreads,
+		ExistsHashTable* fullMoveHash)
+{
+	FullMoveGenShared sh(b,hist,maxSteps,winLossPrune,numThreads);
+	FullMoveNode root;
+	root.hash = b.sitCurrentHash;
+	root.key = 0;
+	root.move = ERRORMOVE;
+	root.ns = 0;
+	root.depth = 0;
+	Board copy = b;
+	root.isLeaf = isFullMoveLeaf(sh,copy,0);
+	sh.shards[0][0].push_back(root);
+
+	runOnThreads(numThreads,[&sh](int thread) {genFullMovesParallelThread(sh,thread);});
+
+	vector<FullMoveNode> leaves;
+	for(int t = 0; t<numThreads; t++)
+		leaves.insert(leaves.end(),sh.leaves[t].begin(),sh.leaves[t].end());
+	std::sort(leaves.begin(),leaves.end(),fullMoveNodeKeyLess);
+
+	fullMoveHash->clear();
+	for(int i = 0; i<(int)leaves.size(); i++)
+	{
+		if(fullMoveHash->lookup(leaves[i].hash))
+			continue;
+		fullMoveHash->record(leaves[i].hash);
+		moves.push_back(leaves[i].move);
+	}
+}
+
+void SearchUtils::genFullMovesParallel(const Board& board, const BoardHistory& hist, vector<move_t>& moves, int maxSteps,
+		bool winLossPrune, int numThreads, const function<void(int,const function<void(int)>&)>& runOnThreads,
+		ExistsHashTable* fullMoveHash)
+{
+	if(numThreads <= 1 || maxSteps <= 0)
+	{
+		genFullMoves(board,hist,moves,maxSteps,winLossPrune,fullMoveHash);
+		return;
+	}
+
+	Board b = board;
+
+	if(winLossPrune)
+	{
+		move_t winningMove = getWinningFullMove(b);
+		if(winningMove != ERRORMOVE)
+		{moves.push_back(winningMove); return;}
+	}
+
+	if(winLossPrune && (BoardTrees::goalDist(b,b.player,maxSteps) <= 4 || BoardTrees::canElim(b,b.player,maxSteps)))
+		winLossPrune = false;
+
+	genFullMovesParallelHelper(b, hist, moves, maxSteps, winLossPrune, numThreads, runOnThreads, fullMoveHash);
+
+	if(winLossPrune && moves.size() == 0)
+		genFullMovesParallelHelper(b, hist, moves, maxSteps, false, numThreads, runOnThreads, fullMoveHash);
+}
+
 //HELPERS - REGULAR GEN--------------------------------------------------------------------------
 
 int SearchUtils::genRegularMoves(const Board& b, move_t* mv)
@@ -1764,7 +2024,7 @@ SearchHashEntry::SearchHashEntry()
 	key = 0;
 }
 
-void SearchHashEntry::record(hash_t hash, int16_t depth, eval_t eval, flag_t flag, move_t move)
+void SearchHashEntry::record(hash_t hash, uint8_t age, int16_t depth, eval_t eval, flag_t flag, move_t move)
 {
 	//Assert that eval uses only only 21 bits (except for sign extension)
 	DEBUGASSERT((eval & 0xFFE00000) == 0 || (eval & 0xFFE00000) == 0xFFE00000);
@@ -1778,7 +2038,7 @@ void SearchHashEntry::record(hash_t hash, int16_t depth, eval_t eval, flag_t fla
 	uint64_t rData = ((uint64_t)move << 32) | subWord;
 
 	data = rData;
-	key = hash ^ rData;
+	key = ((hash ^ rData) & ~AGE_MASK) | age;
 }
 
 bool SearchHashEntry::lookup(hash_t hash, int16_t& depth4, eval_t& eval, flag_t& flag, move_t& move)
@@ -1787,7 +2047,8 @@ bool SearchHashEntry::lookup(hash_t hash, int16_t& depth4, eval_t& eval, flag_t&
 	uint64_t rKey = key;
 
 	//Verify that hash key matches, using lockless xor scheme
-	if((rKey ^ rData) != hash)
+	//The age bits are excluded, the slot index already accounts for those bits of the hash
+	if(((rKey ^ rData ^ hash) & ~AGE_MASK) != 0)
 		return false;
 
 	uint32_t subWord = (uint32_t) rData;
@@ -1805,51 +2066,85 @@ bool SearchHashEntry::lookup(hash_t hash, int16_t& depth4, eval_t& eval, flag_t&
 	return true;
 }
 
+uint8_t SearchHashEntry::getAge() const
+{
+	return (uint8_t)(key & AGE_MASK);
+}
+
+int16_t SearchHashEntry::getDepth4() const
+{
+	uint32_t subWord = (uint32_t)data;
+	return (int16_t)(((int32_t)(subWord << 21)) >> 23);
+}
+
+flag_t SearchHashEntry::getFlag() const
+{
+	return (flag_t)(data & 0x3);
+}
+
 int SearchHashTable::getExp(uint64_t maxMem)
 {
   uint64_t maxEntries = maxMem / sizeof(SearchHashEntry);
   int shift = 0;
   while(shift < 63 && (1ULL << (shift+1)) <= maxEntries)
     shift++;
-  return max(shift,10);
+  return max(shift,MIN_EXP);
 }
 
 SearchHashTable::SearchHashTable(int exp)
 {
+	if(exp < MIN_EXP)
+		Global::fatalError("Cannot have SearchHashTable size with exp < " + Global::intToString(MIN_EXP) + "!");
+
 	exponent = exp;
 	size = ((hash_t)1) << exponent;
-	mask = size-1;
-	entries = new SearchHashEntry[size];
+	bucketMask = (size >> BUCKET_EXP) - 1;
+
+	//Align to the size of a bucket so that each bucket occupies exactly one cache line
+	const uintptr_t bucketBytes = sizeof(SearchHashEntry) * BUCKET_SIZE;
+	entriesBuf = new SearchHashEntry[size + BUCKET_SIZE];
+	uintptr_t addr = (uintptr_t)entriesBuf;
+	entries = (SearchHashEntry*)((addr + bucketBytes - 1) & ~(bucketBytes - 1));
+	age = 0;
 }
 
 SearchHashTable::~SearchHashTable()
 {
-	delete[] entries;
+	delete[] entriesBuf;
 }
 
 void SearchHashTable::clear()
 {
 	for(hash_t i = 0; i<size; i++)
 		entries[i] = SearchHashEntry();
+	age = 0;
+}
+
+void SearchHashTable::newSearch()
+{
+	age++;
 }
 
 bool SearchHashTable::lookup(move_t& hashMove, eval_t& hashEval, int16_t& hashDepth4, flag_t& hashFlag, const Board& b, int cDepth)
 {
-	//Compute appropriate slot
+	//Compute appropriate bucket
   hash_t hash = b.sitCurrentHash;
-  int hashSlot = (int)(hash & mask);
+  SearchHashEntry* bucket = entries + ((hash & bucketMask) << BUCKET_EXP);
 
   //Attempt to look up the entry
-  if(entries[hashSlot].lookup(hash,hashDepth4,hashEval,hashFlag,hashMove))
+  for(int i = 0; i<BUCKET_SIZE; i++)
   {
-  	//Adjust for terminal eval
-    if(SearchUtils::isTerminalEval(hashEval))
-    {
-    	int wlDepth = hashEval > 0 ? Eval::WIN - hashEval : hashEval - Eval::LOSE;
-    	wlDepth += cDepth;
-    	hashEval = hashEval > 0 ? Eval::WIN - wlDepth : Eval::LOSE + wlDepth;
-    }
-    return true;
+		if(bucket[i].lookup(hash,hashDepth4,hashEval,hashFlag,hashMove))
+		{
+			//Adjust for terminal eval
+			if(SearchUtils::isTerminalEval(hashEval))
+			{
+				int wlDepth = hashEval > 0 ? Eval::WIN - hashEval : hashEval - Eval::LOSE;
+				wlDepth += cDepth;
+				hashEval = hashEval > 0 ? Eval::WIN - wlDepth : Eval::LOSE + wlDepth;
+			}
+			return true;
+		}
   }
   return false;
 }
@@ -1870,60 +2165,194 @@ void SearchHashTable::record(const Board& b, int cDepth, int16_t depth4, eval_t
 		eval = eval > 0 ? Eval::WIN - wlDepth : Eval::LOSE + wlDepth;
 	}
 
-	//Record the hash!
+	//Find the entry to replace
+	//If this position is already in the bucket, overwrite it. Otherwise replace the first empty entry, or else
+	//the entry from an older search, or else the shallowest entry.
   hash_t hash = b.sitCurrentHash;
-	int hashSlot = (int)(hash & mask);
-	entries[hashSlot].record(hash,depth4,eval,flag,move);
+  SearchHashEntry* bucket = entries + ((hash & bucketMask) << BUCKET_EXP);
+  SearchHashEntry* replace = NULL;
+  int replaceScore = 0x7FFFFFFF;
+  for(int i = 0; i<BUCKET_SIZE; i++)
+  {
+  	SearchHashEntry* entry = bucket + i;
+		if(((entry->key ^ entry->data ^ hash) & ~SearchHashEntry::AGE_MASK) == 0)
+		{replace = entry; break;}
+
+		if(entry->getFlag() == Flags::FLAG_NONE)
+		{
+			if(replaceScore > -0x10000)
+			{replace = entry; replaceScore = -0x10000;}
+			continue;
+		}
+
+		//Depths fit in 9 bits, so an older search always scores lower than the current one
+		int score = entry->getDepth4();
+		if(entry->getAge() != age)
+			score -= 0x400;
+		if(score < replaceScore)
+		{replace = entry; replaceScore = score;}
+  }
+
+	//Record the hash!
+	replace->record(hash,age,depth4,eval,flag,move);
 }
 
-ExistsHashTable::ExistsHashTable(int exp)
+EvalCacheEntry::EvalCacheEntry()
 {
-	if(exp > 21)
-		Global::fatalError("Cannot have ExistsHashTable size with exp > 21!");
+	data = 0;
+	key = 0;
+}
+
+EvalCache::EvalCache(int exp)
+{
+	if(exp < 0 || exp > 40)
+		Global::fatalError("Invalid EvalCache exp: " + Global::intToString(exp));
 
 	exponent = exp;
 	size = ((hash_t)1) << exponent;
 	mask = size-1;
-	hashKeys = new hash_t[size];
-	clear();
+	entries = new EvalCacheEntry[size];
+}
+
+EvalCache::~EvalCache()
+{
+	delete[] entries;
+}
+
+void EvalCache::clear()
+{
+	for(hash_t i = 0; i<size; i++)
+		entries[i] = EvalCacheEntry();
+}
+
+bool EvalCache::lookup(hash_t key, eval_t& eval)
+{
+	EvalCacheEntry* entry = entries + (key & mask);
+	uint64_t rData = entry->data;
+	uint64_t rKey = entry->key;
+
+	//Verify that the key matches, using lockless xor scheme, and that there is an entry here at all
+	if((rKey ^ rData) != key || (rData >> 32) == 0)
+		return false;
+
+	eval = (eval_t)(int32_t)(uint32_t)rData;
+	return true;
+}
+
+void EvalCache::record(hash_t key, eval_t eval)
+{
+	//The high half marks the entry as filled
+	uint64_t rData = (1ULL << 32) | (uint32_t)eval;
+	EvalCacheEntry* entry = entries + (key & mask);
+	entry->data = rData;
+	entry->key = key ^ rData;
+}
+
+static const int EXISTS_HASH_INITIAL_EXP = 12;
+
+ExistsHashTable::ExistsHashTable(int maxExp)
+{
+	if(maxExp > 21)
+		Global::fatalError("Cannot have ExistsHashTable size with exp > 21!");
+
+	maxExponent = maxExp;
+	exponent = 0;
+	size = 0;
+	mask = 0;
+	hashKeys = NULL;
+	stamps = NULL;
+	generation = 1;
+	count = 0;
+	resize(min(maxExp,EXISTS_HASH_INITIAL_EXP));
 }
 
 ExistsHashTable::~ExistsHashTable()
 {
 	delete[] hashKeys;
+	delete[] stamps;
 }
 
 void ExistsHashTable::clear()
 {
-	//For entry 0, put a hash value that is nonzero everywhere (so it couldn't possibly go there under)
-	//normal operation.
-	//For all other entries, put a hash value that is zero everywhere, which couldn't possibly go there under
-	//normal operation
-	hashKeys[0] = 0xFFFFFFFFFFFFFFFFULL;
-	for(hash_t i = 1; i<size; i++)
-		hashKeys[i] = 0;
+	count = 0;
+	generation++;
+	//Wrapped around, so old stamps could look current
+	if(generation == 0)
+	{
+		for(hash_t i = 0; i<size; i++)
+			stamps[i] = 0;
+		generation = 1;
+	}
+}
+
+void ExistsHashTable::resize(int newExponent)
+{
+	hash_t oldSize = size;
+	hash_t* oldKeys = hashKeys;
+	uint32_t* oldStamps = stamps;
+
+	exponent = newExponent;
+	size = ((hash_t)1) << exponent;
+	mask = size-1;
+	hashKeys = new hash_t[size];
+	stamps = new uint32_t[size];
+	for(hash_t i = 0; i<size; i++)
+		stamps[i] = 0;
+
+	//Move over everything recorded in the current generation
+	for(hash_t i = 0; i<oldSize; i++)
+	{
+		if(oldStamps[i] != generation)
+			continue;
+		hash_t idx = oldKeys[i] & mask;
+		while(stamps[idx] == generation)
+			idx = (idx+1) & mask;
+		hashKeys[idx] = oldKeys[i];
+		stamps[idx] = generation;
+	}
+
+	delete[] oldKeys;
+	delete[] oldStamps;
 }
 
 bool ExistsHashTable::lookup(const Board& b)
 {
-	hash_t hash = b.sitCurrentHash;
-	int hashIndex = (int)(hash & mask);
-	int hashIndex2 = (int)((hash >> exponent) & mask);
-	int hashIndex3 = (int)((hash >> (exponent*2)) & mask);
-	if(hashKeys[hashIndex] == hash || hashKeys[hashIndex2] == hash || hashKeys[hashIndex3] == hash)
-		return true;
+	return lookup(b.sitCurrentHash);
+}
+
+void ExistsHashTable::record(const Board& b)
+{
+	record(b.sitCurrentHash);
+}
 
+bool ExistsHashTable::lookup(hash_t hash)
+{
+	for(hash_t idx = hash & mask; stamps[idx] == generation; idx = (idx+1) & mask)
+	{
+		if(hashKeys[idx] == hash)
+			return true;
+	}
 	return false;
 }
 
-void ExistsHashTable::record(const Board& b)
+void ExistsHashTable::record(hash_t hash)
 {
-  hash_t hash = b.sitCurrentHash;
-	int hashIndex = (int)(hash & mask);
-	int hashIndex2 = (int)((hash >> exponent) & mask);
-	int hashIndex3 = (int)((hash >> (exponent*2)) & mask);
-	hashKeys[hashIndex] = hash;
-	hashKeys[hashIndex2] = hash;
-	hashKeys[hashIndex3] = hash;
+	if(count * 2 >= size)
+	{
+		if(exponent < maxExponent)
+			resize(exponent+1);
+		else if((count+1) * 4 > size * 3)
+			return;
+	}
+
+	hash_t idx = hash & mask;
+	for(; stamps[idx] == generation; idx = (idx+1) & mask)
+	{
+		if(hashKeys[idx] == hash)
+			return;
+	}
+	hashKeys[idx] = hash;
+	stamps[idx] = generation;
+	count++;
 }
 
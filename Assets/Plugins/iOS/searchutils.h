@@ -8,6 +8,7 @@
 #ifndef SEARCHUTILS_H_
 #define SEARCHUTILS_H_
 
+#include <functional>
 #include "board.h"
 #include "boardhistory.h"
 #include "eval.h"
@@ -70,6 +71,13 @@ namespace SearchUtils
 	void genFullMoves(const Board& b, const BoardHistory& hist, vector<move_t>& moves, int maxSteps,
 			bool winLossPrune, ExistsHashTable* fullMoveHash);
 
+	//Same as genFullMoves, with the same moves in the same order, but expands the positions after each number
+	//of steps in parallel across numThreads threads. runOnThreads(numThreads,job) must call job(i) for each i in
+	//[0,numThreads) concurrently, each on its own thread, and return once all are done.
+	void genFullMovesParallel(const Board& b, const BoardHistory& hist, vector<move_t>& moves, int maxSteps,
+			bool winLossPrune, int numThreads, const function<void(int,const function<void(int)>&)>& runOnThreads,
+			ExistsHashTable* fullMoveHash);
+
 	void genFullMoveHelper(Board& b, const BoardHistory& hist, pla_t pla, vector<move_t>& moves, move_t moveSoFar,
 			int stepIndex, int maxSteps, hash_t posStartHash, bool winLossPrune, ExistsHashTable* fullMoveHash);
 
@@ -8,12 +8,22 @@
 #include <iostream>
 #include <cmath>
 #include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <functional>
 #include "global.h"
 #include "rand.h"
 #include "bitmap.h"
 #include "board.h"
+#include "compactboard.h"
 #include "boardmovegen.h"
+#include "boardhistory.h"
+#include "search.h"
+#include "searchutils.h"
 #include "setup.h"
+#include "featurecache.h"
 #include "tests.h"
 #include "arimaaio.h"
 
@@ -26,6 +36,11 @@ static void testBmpBoolOps(uint64_t seed);
 static void testBmpShifty(uint64_t seed);
 static void testBoardStepConsistency(uint64_t seed);
 static void testBoardMoveGenConsistency(uint64_t seed);
+static void testBoardUndoConsistency(uint64_t seed);
+static void testCompactBoardConsistency(uint64_t seed);
+static void testFullMoveGenParallel(uint64_t seed);
+static void testMovesFileReader(uint64_t seed);
+static void testFeatureCacheEncoding();
 
 void Tests::runBasicTests(uint64_t seed)
 {
@@ -60,6 +75,29 @@ void Tests::runBasicTests(uint64_t seed)
 	for(int i = 0; i<400; i++)
 	{testBoardMoveGenConsistency(rand.nextUInt64());}
 
+	cout << "Undo consistency" << endl;
+	for(int i = 0; i<200; i++)
+	{testBoardUndoConsistency(rand.nextUInt64());}
+
+	cout << "Compact board consistency" << endl;
+	for(int i = 0; i<200; i++)
+	{testCompactBoardConsistency(rand.nextUInt64());}
+
+	cout << "----Testing Search Utils----" << endl;
+
+	cout << "Parallel full move gen" << endl;
+	for(int i = 0; i<40; i++)
+	{testFullMoveGenParallel(rand.nextUInt64());}
+
+	cout << "----Testing IO----" << endl;
+
+	cout << "Moves file reader" << endl;
+	for(int i = 0; i<4; i++)
+	{testMovesFileReader(rand.nextUInt64());}
+
+	cout << "Feature cache encoding" << endl;
+	testFeatureCacheEncoding();
+
 	cout << "Testing complete!" << endl;
 }
 
@@ -85,6 +123,33 @@ static void testBoardMoveGenConsistency(uint64_t seed)
 		if(b.step < 3 && (pushNum != 0) != BoardMoveGen::canPushPulls(b,b.player))
 		{cout << "Pushpulls != canPushPull" << endl; cout << b << endl; exit(0);}
 
+		//Every push and pull, found by trying each pair of opposing adjacent pieces with each empty square
+		if(b.step < 3)
+		{
+			int bruteNum = 0;
+			for(loc_t k = 0; k<64; k++)
+			{
+				if(b.owners[k] == NPLA)
+				{continue;}
+				for(int dir = 0; dir<4; dir++)
+				{
+					if(!Board::ADJOKAY[dir][k] || b.owners[k+Board::ADJOFFSETS[dir]] != OPP(b.owners[k]))
+					{continue;}
+					for(int dir2 = 0; dir2<4; dir2++)
+					{
+						if(dir2 == dir || !Board::ADJOKAY[dir2][k])
+						{continue;}
+						move_t move = Board::getMove(k+Board::STEPOFFSETS[dir2],k+Board::ADJOFFSETS[dir]+Board::STEPOFFSETS[3-dir]);
+						Board copy = b;
+						if(copy.makeMoveLegal(move))
+						{bruteNum++;}
+					}
+				}
+			}
+			if(bruteNum != pushNum)
+			{cout << "Pushpulls " << pushNum << " != brute force " << bruteNum << endl; cout << b << endl; exit(0);}
+		}
+
 		int num = stepNum+pushNum;
 
 		if(b.step != 0 && b.posCurrentHash != b.posStartHash)
@@ -108,6 +173,438 @@ static void testBoardMoveGenConsistency(uint64_t seed)
 	delete[] hm;
 }
 
+static bool boardsIdentical(const Board& b0, const Board& b1)
+{
+	for(int i = 0; i<64; i++)
+		if(b0.owners[i] != b1.owners[i] || b0.pieces[i] != b1.pieces[i])
+			return false;
+	for(int p = 0; p<2; p++)
+	{
+		for(int i = 0; i<NUMTYPES; i++)
+			if(b0.pieceMaps[p][i] != b1.pieceMaps[p][i] || b0.pieceCounts[p][i] != b1.pieceCounts[p][i])
+				return false;
+		for(int i = 0; i<4; i++)
+			if(b0.trapGuardCounts[p][i] != b1.trapGuardCounts[p][i])
+				return false;
+	}
+	return b0.frozenMap == b1.frozenMap && b0.player == b1.player && b0.step == b1.step && b0.turnNumber == b1.turnNumber &&
+			b0.posStartHash == b1.posStartHash && b0.posCurrentHash == b1.posCurrentHash && b0.sitCurrentHash == b1.sitCurrentHash;
+}
+
+static void testBoardUndoConsistency(uint64_t seed)
+{
+	Rand rand(seed);
+
+	move_t* mv = new move_t[512];
+
+	Board b = Board();
+	Setup::setupRandom(b,seed);
+
+	for(int i = 0; i<200; i++)
+	{
+		int num = BoardMoveGen::genSteps(b,b.player,mv);
+		if(b.step < 3)
+		{num += BoardMoveGen::genPushPulls(b,b.player,mv+num);}
+		if(b.step != 0)
+		{mv[num++] = Board::getMove(PASSSTEP);}
+
+		if(num == 0)
+		{break;}
+
+		//Also try some multi-step moves built from the generated ones, legal or not
+		for(int j = 0; j<num+8; j++)
+		{
+			move_t move = j < num ? mv[j] : Board::concatMoves(mv[rand.nextUInt(num)],mv[rand.nextUInt(num)],1);
+
+			Board copy = b;
+			Board made = b;
+			UndoMoveData udata;
+			bool legal = copy.makeMoveLegal(move,udata);
+			bool madeLegal = made.makeMoveLegal(move);
+			if(legal != madeLegal || (legal && !boardsIdentical(copy,made)))
+			{cout << "makeMoveLegal with undo differs: " << writeMove(b,move) << " " << b; exit(0);}
+			copy.undoMove(udata);
+			if(!boardsIdentical(copy,b))
+			{cout << "Undo did not restore board: " << writeMove(b,move) << " " << b; exit(0);}
+
+			if(legal)
+			{
+				copy.makeMove(move,udata);
+				copy.undoMove(udata);
+				if(!boardsIdentical(copy,b))
+				{cout << "Undo of makeMove did not restore board: " << writeMove(b,move) << " " << b; exit(0);}
+			}
+		}
+		b.makeMove(mv[rand.nextUInt(num)]);
+	}
+
+	delete[] mv;
+}
+
+static void testCompactBoardConsistency(uint64_t seed)
+{
+	Rand rand(seed);
+
+	move_t* mv = new move_t[512];
+
+	Board b = Board();
+	Setup::setupRandom(b,seed);
+	CompactBoard cb(b);
+
+	for(int i = 0; i<200; i++)
+	{
+		Board rebuilt = cb.toBoard();
+		if(!boardsIdentical(rebuilt,b) || cb.getSitCurrentHash() != b.sitCurrentHash)
+		{cout << "Compact board differs: " << b << rebuilt; exit(0);}
+		for(int k = 0; k<64; k++)
+		{
+			if(cb.ownerAt(k) != b.owners[k] || cb.pieceAt(k) != b.pieces[k])
+			{cout << "Compact board mailbox differs at " << k << " " << b; exit(0);}
+		}
+
+		int num = BoardMoveGen::genSteps(b,b.player,mv);
+		if(b.step < 3)
+		{num += BoardMoveGen::genPushPulls(b,b.player,mv+num);}
+		if(b.step != 0)
+		{mv[num++] = Board::getMove(PASSSTEP);}
+
+		if(num == 0)
+		{break;}
+
+		move_t move = mv[rand.nextUInt(num)];
+		b.makeMove(move);
+		cb.makeMove(move);
+	}
+
+	delete[] mv;
+}
+
+//genFullMovesParallel must give exactly the moves of genFullMoves, in the same order
+static void testFullMoveGenParallel(uint64_t seed)
+{
+	Rand rand(seed);
+
+	move_t* mv = new move_t[512];
+
+	//Both sides
+	Board b = Board();
+	Setup::setupRandom(b,seed);
+	Setup::setupRandom(b,seed+1);
+
+	//Random steps, so that some positions are partway through a turn
+	int numSteps = rand.nextUInt(40);
+	for(int i = 0; i<numSteps && b.getWinner() == NPLA; i++)
+	{
+		int num = BoardMoveGen::genSteps(b,b.player,mv);
+		if(b.step < 3)
+		{num += BoardMoveGen::genPushPulls(b,b.player,mv+num);}
+		if(num == 0)
+		{break;}
+		b.makeMove(mv[rand.nextUInt(num)]);
+	}
+
+	BoardHistory hist(b);
+	ExistsHashTable fullMoveHash(18);
+	auto runOnThreads = [](int numThreads, const function<void(int)>& job) {
+		vector<std::thread> threads;
+		for(int t = 1; t<numThreads; t++)
+			threads.push_back(std::thread(job,t));
+		job(0);
+		for(int t = 0; t<(int)threads.size(); t++)
+			threads[t].join();
+	};
+
+	for(int maxSteps = 1; maxSteps <= 4-b.step; maxSteps++)
+	{
+		for(int winLossPrune = 0; winLossPrune <= 1; winLossPrune++)
+		{
+			vector<move_t> moves;
+			SearchUtils::genFullMoves(b,hist,moves,maxSteps,winLossPrune,&fullMoveHash);
+			for(int numThreads = 2; numThreads <= 4; numThreads++)
+			{
+				vector<move_t> parallelMoves;
+				SearchUtils::genFullMovesParallel(b,hist,parallelMoves,maxSteps,winLossPrune,numThreads,runOnThreads,&fullMoveHash);
+				if(parallelMoves != moves)
+				{cout << "Parallel full move gen differs, " << numThreads << " threads, maxSteps " << maxSteps << " winLossPrune "
+						<< winLossPrune << ", " << parallelMoves.size() << " vs " << moves.size() << " moves" << endl; cout << b; exit(0);}
+			}
+		}
+	}
+
+	delete[] mv;
+}
+
+//A random game of whole turns of single steps, without captures, as text for a moves file
+static string randomGameText(Rand& rand, int& numMoves)
+{
+	move_t* mv = new move_t[512];
+
+	GameRecord setup = readMoves(string(
+			"1g Ra1 Rb1 Rc1 Rd1 Ce1 Rf1 Dg1 Rh1 Da2 Cb2 Rc2 Hd2 He2 Ef2 Mg2 Rh2\n"
+			"1s ra7 hb7 hc7 ed7 de7 df7 mg7 ch7 ra8 rb8 cc8 rd8 re8 rf8 rg8 rh8\n"));
+	Board start = setup.board;
+	Board b = start;
+
+	vector<move_t> moves;
+	int numTurns = 2 + rand.nextUInt(20);
+	for(int t = 0; t<numTurns && b.getWinner() == NPLA; t++)
+	{
+		Board copy = b;
+		move_t move = PASSMOVE;
+		for(int i = 0; i<4; i++)
+		{
+			int num = BoardMoveGen::genSteps(copy,copy.player,mv);
+			int k = 0;
+			for(int j = 0; j<num; j++)
+			{
+				Board temp = copy;
+				if(temp.makeMoveLegal(mv[j]) && temp.pieceCounts[0][0] + temp.pieceCounts[1][0] == copy.pieceCounts[0][0] + copy.pieceCounts[1][0])
+				{mv[k++] = mv[j];}
+			}
+			if(k == 0)
+			{break;}
+			move_t step = mv[rand.nextUInt(k)];
+			move = Board::concatMoves(move,step,i);
+			copy.makeMove(step);
+		}
+		if(copy.player == b.player || !b.makeMoveLegal(move))
+		{break;}
+		moves.push_back(move);
+	}
+
+	delete[] mv;
+	numMoves = moves.size();
+	return writeGame(start,moves);
+}
+
+static bool recordsIdentical(const GameRecord& r0, const GameRecord& r1)
+{
+	return r0.moves == r1.moves && writeGameRecord(r0) == writeGameRecord(r1);
+}
+
+//MovesFileReader must split a file into exactly the records that getline(in,str,';') always has, mapped or not
+static void testMovesFileReader(uint64_t seed)
+{
+	Rand rand(seed);
+	static const int CHUNK_SIZE = 1 << 16; //As in MovesFileReader when not mapped
+
+	vector<string> games;
+	vector<int> gameNumMoves;
+	int maxGameSize = 0;
+	for(int i = 0; i<8; i++)
+	{
+		int numMoves;
+		games.push_back(randomGameText(rand,numMoves));
+		gameNumMoves.push_back(numMoves);
+		maxGameSize = max(maxGameSize,(int)games[i].size());
+	}
+
+	//Games, blank records and Windows line endings, a ';' exactly at the end of the first chunk or exactly at the
+	//start of the second, and no ';' after the last record
+	string text;
+	vector<int> expectedNumMoves;
+	int boundary = CHUNK_SIZE - 1 + (int)rand.nextUInt(2);
+	bool hitBoundary = false;
+	while(text.size() < (size_t)CHUNK_SIZE*2)
+	{
+		int r = rand.nextUInt(games.size());
+		string game = games[r];
+		if(rand.nextUInt(4) == 0)
+		{
+			string crlf;
+			for(int i = 0; i<(int)game.size(); i++)
+			{
+				if(game[i] == '\n')
+				{crlf += '\r';}
+				crlf += game[i];
+			}
+			game = crlf;
+		}
+		//Pad the game that ends the first chunk so that its ';' lands exactly at the boundary
+		if(!hitBoundary && text.size() + 4*maxGameSize + 16 >= (size_t)boundary)
+		{
+			text += string(boundary - text.size() - game.size(),' ');
+			hitBoundary = true;
+		}
+		else if(rand.nextUInt(4) == 0)
+		{text += rand.nextUInt(2) == 0 ? ";" : "\r\n \t;";}
+		text += game;
+		text += ";\n";
+		expectedNumMoves.push_back(gameNumMoves[r]);
+	}
+	text += games[0];
+	expectedNumMoves.push_back(gameNumMoves[0]);
+	if(text[boundary] != ';')
+	{cout << "Moves file reader test did not place a ';' at " << boundary << endl; exit(0);}
+
+	//There are no escapes in the generated text to unescape
+	vector<GameRecord> expected;
+	istringstream textIn(text);
+	string str;
+	while(getline(textIn,str,';'))
+	{
+		if(str.find_first_not_of(" \n\t\r") == string::npos)
+			continue;
+		expected.push_back(readMoves(str));
+	}
+	if(expected.size() != expectedNumMoves.size())
+	{cout << "Moves file reader test expected " << expectedNumMoves.size() << " records, getline found " << expected.size() << endl; exit(0);}
+	for(int i = 0; i<(int)expected.size(); i++)
+	{
+		if((int)expected[i].moves.size() != expectedNumMoves[i])
+		{cout << "Moves file reader test record " << i << " did not parse" << endl; exit(0);}
+	}
+
+	string file = "movesfilereadertest.tmp";
+	ofstream out(file.c_str(), ios::out | ios::binary);
+	out << text;
+	out.close();
+
+	int numRecords = expected.size();
+	for(int useMapping = 0; useMapping <= 1; useMapping++)
+	{
+		MovesFileReader reader(file,useMapping);
+		GameRecord record;
+		for(int i = 0; i<numRecords; i++)
+		{
+			if(!reader.next(record) || !recordsIdentical(record,expected[i]))
+			{cout << "Moves file reader next() differs at record " << i << " mapped " << useMapping << endl; exit(0);}
+		}
+		if(reader.next(record))
+		{cout << "Moves file reader found extra record, mapped " << useMapping << endl; exit(0);}
+		if(reader.numRecords() != numRecords)
+		{cout << "Moves file reader numRecords " << reader.numRecords() << " != " << numRecords << endl; exit(0);}
+
+		//Random access from a fresh reader, partway through reading it in order, and in order again after each get
+		MovesFileReader reader2(file,useMapping);
+		int numRead = rand.nextUInt(numRecords);
+		for(int i = 0; i<numRead; i++)
+			reader2.next(record);
+		for(int j = 0; j<20; j++)
+		{
+			int idx = rand.nextUInt(numRecords);
+			if(!recordsIdentical(reader2.get(idx),expected[idx]))
+			{cout << "Moves file reader get(" << idx << ") differs, mapped " << useMapping << endl; exit(0);}
+			if(idx+1 < numRecords && (!reader2.next(record) || !recordsIdentical(record,expected[idx+1])))
+			{cout << "Moves file reader next() after get(" << idx << ") differs, mapped " << useMapping << endl; exit(0);}
+		}
+	}
+
+	vector<GameRecord> all = readMovesFile(file);
+	if(all.size() != expected.size())
+	{cout << "readMovesFile found " << all.size() << " records, expected " << expected.size() << endl; exit(0);}
+	for(int i = 0; i<(int)all.size(); i++)
+	{
+		if(!recordsIdentical(all[i],expected[i]))
+		{cout << "readMovesFile differs at record " << i << endl; exit(0);}
+	}
+
+	remove(file.c_str());
+}
+
+static bool featureMatchesIdentical(const FeatureMatches& m0, const FeatureMatches& m1)
+{
+	return m0.winners == m1.winners && m0.matchTeamStart == m1.matchTeamStart &&
+			m0.teamFeatureStart == m1.teamFeatureStart && m0.features == m1.features;
+}
+
+//Matches must decode exactly as they were encoded, and only a complete header with the right key is up to date
+static void testFeatureCacheEncoding()
+{
+	static const int NUM_FEATURES = 300000;
+
+	//Features out of order so that deltas are negative, empty teams, and features needing multi-byte varints
+	FeatureMatches block;
+	findex_t team0[5] = {5, 3, 200000, 1, 299999};
+	findex_t team1[1] = {0};
+	findex_t team2[3] = {127, 128, 16384};
+	block.beginMatch(1);
+	block.addTeam(team0,5);
+	block.addTeam(NULL,0);
+	block.addTeam(team1,1);
+	block.beginMatch(0);
+	block.addTeam(NULL,0);
+	block.beginMatch(2);
+	block.addTeam(team2,3);
+	block.addTeam(team0,5);
+	block.addTeam(team2,3);
+
+	FeatureMatches empty;
+
+	vector<uint8_t> bytes;
+	FeatureCache::encodeMatches(block,bytes);
+	FeatureCache::encodeMatches(empty,bytes);
+	FeatureCache::encodeMatches(block,bytes);
+
+	FeatureBuffer buf;
+	FeatureMatches decoded;
+	const uint8_t* ptr = bytes.data();
+	const uint8_t* end = bytes.data() + bytes.size();
+	const FeatureMatches* expected[3] = {&block, &empty, &block};
+	for(int i = 0; i<3; i++)
+	{
+		ptr = FeatureCache::decodeMatches(ptr,end,NUM_FEATURES,buf,decoded);
+		if(!featureMatchesIdentical(decoded,*expected[i]))
+		{cout << "Feature cache block " << i << " did not decode to what was encoded" << endl; exit(0);}
+	}
+	if(ptr != end)
+	{cout << "Feature cache decoding did not consume all the bytes" << endl; exit(0);}
+
+	FeatureCache::Key key;
+	key.featureSetHash = 0x0123456789ABCDEFULL;
+	key.numFeatures = NUM_FEATURES;
+	key.extractorHash = 0x1122334455667788ULL;
+	key.extractorVersion = 7;
+	key.gamesFileSize = 12345;
+	key.gamesFileHash = 0xFEDCBA9876543210ULL;
+	key.moveType = 3;
+	key.doFiltering = 1;
+	key.gameKeepPropBits = 0x3FF0000000000000ULL;
+	key.moveKeepPropBits = 0x3FE0000000000000ULL;
+	key.moveKeepThreshold = 5;
+
+	FeatureCache::Header header;
+	header.version = FeatureCache::VERSION;
+	header.key = key;
+	header.numGames = 3;
+	header.numMatches = 2*block.numMatches();
+
+	FeatureCache::Key otherKey = key;
+	otherKey.gamesFileHash++;
+	FeatureCache::Key newerExtractorKey = key;
+	newerExtractorKey.extractorVersion++;
+
+	string file = "featurecachetest.tmp";
+	for(int complete = 0; complete <= 1; complete++)
+	{
+		header.complete = complete;
+		vector<uint8_t> fileBytes;
+		FeatureCache::writeHeader(fileBytes,header);
+		fileBytes.insert(fileBytes.end(),bytes.begin(),bytes.end());
+		ofstream out(file.c_str(), ios::out | ios::binary | ios::trunc);
+		out.write((const char*)fileBytes.data(),fileBytes.size());
+		out.close();
+
+		if(FeatureCache::isUpToDate(file,key) != (complete == 1))
+		{cout << "Feature cache isUpToDate is wrong for a " << (complete ? "complete" : "incomplete") << " file" << endl; exit(0);}
+		if(FeatureCache::isUpToDate(file,otherKey))
+		{cout << "Feature cache isUpToDate accepts a different key" << endl; exit(0);}
+		if(FeatureCache::isUpToDate(file,newerExtractorKey))
+		{cout << "Feature cache isUpToDate accepts a different extractor version" << endl; exit(0);}
+	}
+
+	//A header cut short, as if the build was interrupted while writing it
+	vector<uint8_t> fileBytes;
+	FeatureCache::writeHeader(fileBytes,header);
+	ofstream out(file.c_str(), ios::out | ios::binary | ios::trunc);
+	out.write((const char*)fileBytes.data(),fileBytes.size()/2);
+	out.close();
+	if(FeatureCache::isUpToDate(file,key))
+	{cout << "Feature cache isUpToDate accepts a truncated header" << endl; exit(0);}
+
+	remove(file.c_str());
+}
+
 static void testBoardStepConsistency(uint64_t seed)
 {
 	Rand rand(seed);
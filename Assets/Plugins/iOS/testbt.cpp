@@ -36,9 +36,9 @@ static void addWL(const vector<findex_t>& team0, const vector<findex_t>& team1,
 }
 
 
-void Tests::testBTGradient()
+//Feature set A..F plus a prior, and matches between teams of them
+static void buildTestMatches(FeatureSet& fset, vector<vector<vector<findex_t> > >& matches, vector<int>& winners)
 {
-	FeatureSet fset;
 	fgrpindex_t A = fset.add("A");
 	fgrpindex_t B = fset.add("B");
 	fgrpindex_t C = fset.add("C");
@@ -73,9 +73,6 @@ void Tests::testBTGradient()
 	tff.push_back(f);
 	tff.push_back(f);
 
-	vector<vector<vector<findex_t> > > matches;
-	vector<int> winners;
-
 	addWL(ta,tb,100,200,matches,winners);
 	addWL(tb,tc,100,200,matches,winners);
 	addWL(tc,tde,100,200,matches,winners);
@@ -83,6 +80,15 @@ void Tests::testBTGradient()
 	addWL(te,tff,100,200,matches,winners);
 
 	fset.addUniformPrior(1.0,1.0);
+}
+
+void Tests::testBTGradient()
+{
+	FeatureSet fset;
+	vector<vector<vector<findex_t> > > matches;
+	vector<int> winners;
+	buildTestMatches(fset,matches,winners);
+
 	ArimaaFeatureSet afset(&fset,NULL,NULL);
 	BradleyTerry bt(afset,20);
 
@@ -95,3 +101,62 @@ void Tests::testBTGradient()
 
 
 }
+
+//Weighted log likelihood of the matches and the prior under the given log gammas
+static double getLogProb(const FeatureSet& fset, const vector<vector<vector<findex_t> > >& matches, const vector<int>& winners,
+		const vector<double>& logGamma)
+{
+	double logProb = 0;
+	for(int m = 0; m<(int)matches.size(); m++)
+	{
+		double total = 0;
+		for(int t = 0; t<(int)matches[m].size(); t++)
+		{
+			double logStrength = 0;
+			for(int i = 0; i<(int)matches[m][t].size(); i++)
+				logStrength += logGamma[matches[m][t][i]];
+			total += exp(logStrength);
+			if(t == winners[m])
+				logProb += logStrength;
+		}
+		logProb -= log(total);
+	}
+	const vector<FeatureSet::PriorMatch>& pMatches = fset.getPriorMatches();
+	for(int i = 0; i<(int)pMatches.size(); i++)
+	{
+		double w = logGamma[pMatches[i].winner];
+		double l = logGamma[pMatches[i].loser];
+		logProb += pMatches[i].weight * (w - log(exp(w) + exp(l)));
+	}
+	return logProb;
+}
+
+void Tests::testBTMM()
+{
+	FeatureSet fset;
+	vector<vector<vector<findex_t> > > matches;
+	vector<int> winners;
+	buildTestMatches(fset,matches,winners);
+
+	ArimaaFeatureSet afset(&fset,NULL,NULL);
+	BradleyTerry gradient(afset,100);
+	gradient.train(matches,winners);
+	BradleyTerry mm1(afset,400,BradleyTerry::TRAIN_MM,1);
+	mm1.train(matches,winners);
+	BradleyTerry mm2(afset,400,BradleyTerry::TRAIN_MM,2);
+	mm2.train(matches,winners);
+
+	for(int i = 0; i<(int)mm2.logGamma.size(); i++)
+	{
+		cout << fset.getName(i) << " " << gradient.logGamma[i] / log(2.0) << " " << mm2.logGamma[i] / log(2.0) << endl;
+		if(fabs(mm1.logGamma[i] - mm2.logGamma[i]) > 1e-9)
+			Global::fatalError("testBTMM: MM training differs with the number of threads on " + fset.getName(i));
+	}
+
+	//The likelihood is quite flat along the chain of matches, so compare likelihoods rather than the gammas
+	double gradientLogProb = getLogProb(fset,matches,winners,gradient.logGamma);
+	double mmLogProb = getLogProb(fset,matches,winners,mm2.logGamma);
+	cout << "Gradient logProb " << gradientLogProb << " MM logProb " << mmLogProb << endl;
+	if(mmLogProb < gradientLogProb - 0.01)
+		Global::fatalError("testBTMM: MM training did not reach the likelihood of gradient training");
+}
@@ -30,6 +30,7 @@ namespace Tests
 	//Misc Tests---------------
 
 	void testBTGradient();
+	void testBTMM();
 
 	void testPatterns();
 